@@ -0,0 +1,576 @@
+#pragma once
+
+#include "router.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    // Поиск маршрута по иерархии сокращений (Contraction Hierarchies).
+    // Вершины стягиваются по очереди, и для сохранения кратчайших путей между оставшимися вершинами
+    // добавляются рёбра-сокращения. Запрос — двунаправленный поиск только к более старшим вершинам,
+    // после чего сокращения разворачиваются обратно в рёбра исходного графа.
+    template <typename Weight, typename Graph = DirectedWeightedGraph<Weight>>
+    class ContractionHierarchyRouter {
+    public:
+        using RouteInfo = graph::RouteInfo<Weight>;
+
+        // Сокращение from -> to заменяет пару рёбер first (from -> via) и second (via -> to).
+        // Id сокращений продолжают нумерацию рёбер графа
+        struct Shortcut {
+            VertexId from;
+            VertexId to;
+            Weight weight;
+            EdgeId first;
+            EdgeId second;
+        };
+
+        struct Hierarchy {
+            ranges::Storage<size_t> ranks;// номер вершины в порядке стягивания
+            ranges::Storage<Shortcut> shortcuts;
+        };
+
+        // Граф поиска в формате CSR: upward_edges[upward_offsets[v]..upward_offsets[v + 1]) — рёбра и сокращения
+        // из v в более старшие вершины, downward_edges[downward_offsets[v]..downward_offsets[v + 1]) — в v
+        // из более старших. Строится по иерархии, но может быть сохранён вместе с ней
+        struct SearchGraph {
+            ranges::Storage<size_t> upward_offsets;
+            ranges::Storage<EdgeId> upward_edges;
+            ranges::Storage<size_t> downward_offsets;
+            ranges::Storage<EdgeId> downward_edges;
+        };
+
+        // Строит иерархию по графу
+        explicit ContractionHierarchyRouter(const Graph& graph);
+        // Использует ранее построенную иерархию
+        ContractionHierarchyRouter(const Graph& graph, Hierarchy hierarchy);
+        // Использует иерархию и граф поиска, которые могут ссылаться на отображённую в память базу.
+        // Проверяются только размеры массивов, id рёбер и вершин — по ходу поиска
+        ContractionHierarchyRouter(const Graph& graph, Hierarchy hierarchy, SearchGraph search_graph);
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+        const Hierarchy& GetHierarchy() const;
+        const SearchGraph& GetSearchGraph() const;
+
+    private:
+        class Builder;
+
+        struct EdgeData {
+            VertexId from;
+            VertexId to;
+            Weight weight;
+        };
+        using QueueItem = std::pair<Weight, VertexId>;
+        using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>>;
+
+        // Состояние поиска в одном направлении. Массивы живут между запросами потока,
+        // и перед новым запросом сбрасываются только вершины, затронутые предыдущим
+        struct SearchState {
+            std::vector<std::optional<Weight>> weights;
+            std::vector<std::optional<EdgeId>> prev_edges;
+            std::vector<VertexId> touched;
+            std::vector<QueueItem> queue;// двоичная куча с минимальным весом в начале
+
+            void Reset(size_t vertex_count);
+            void Push(VertexId vertex, Weight weight, std::optional<EdgeId> prev_edge);
+            QueueItem Pop();
+        };
+
+        static constexpr Weight ZERO_WEIGHT{};
+        const Graph& graph_;
+        Hierarchy hierarchy_;
+        SearchGraph search_graph_;
+
+        EdgeData GetEdgeData(EdgeId edge_id) const;
+        void BuildSearchGraph();
+        ranges::Range<const EdgeId*> GetSearchEdges(VertexId vertex, bool forward) const;
+        void UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& edges) const;
+    };
+
+    template <typename Weight, typename Graph>
+    class ContractionHierarchyRouter<Weight, Graph>::Builder {
+    public:
+        explicit Builder(const Graph& graph);
+
+        Hierarchy Build();
+
+    private:
+        struct Arc {
+            VertexId vertex;
+            Weight weight;
+            EdgeId edge;
+        };
+
+        // Предел числа вершин, просматриваемых при поиске обходного пути.
+        // Не найденный обход приводит лишь к лишнему сокращению, но не к ошибке
+        static constexpr size_t WITNESS_SETTLED_LIMIT = 500;
+
+        const Graph& graph_;
+        std::vector<std::vector<Arc>> out_arcs_;
+        std::vector<std::vector<Arc>> in_arcs_;
+        std::vector<bool> contracted_;
+        std::vector<int64_t> contracted_neighbors_;
+        std::vector<size_t> ranks_;
+        std::vector<Shortcut> shortcuts_;
+
+        std::vector<std::optional<Weight>> witness_weights_;
+        std::vector<VertexId> witness_touched_;
+
+        static std::vector<Arc> GetNearestArcs(std::vector<Arc> arcs, VertexId exclude);
+        void RunWitnessSearch(VertexId from, VertexId exclude, Weight limit);
+        std::vector<Shortcut> FindShortcuts(VertexId vertex);
+        int64_t GetPriority(VertexId vertex);
+        void Contract(VertexId vertex, size_t rank);
+    };
+
+    template <typename Weight, typename Graph>
+    ContractionHierarchyRouter<Weight, Graph>::Builder::Builder(const Graph& graph)
+        : graph_(graph)
+        , out_arcs_(graph.GetVertexCount())
+        , in_arcs_(graph.GetVertexCount())
+        , contracted_(graph.GetVertexCount())
+        , contracted_neighbors_(graph.GetVertexCount())
+        , ranks_(graph.GetVertexCount())
+        , witness_weights_(graph.GetVertexCount())
+    {
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            const auto& edge = graph.GetEdge(edge_id);
+            if (edge.weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+            if (edge.from == edge.to) {
+                continue;
+            }
+            out_arcs_[edge.from].push_back({ edge.to, edge.weight, edge_id });
+            in_arcs_[edge.to].push_back({ edge.from, edge.weight, edge_id });
+        }
+    }
+
+    template <typename Weight, typename Graph>
+    typename ContractionHierarchyRouter<Weight, Graph>::Hierarchy ContractionHierarchyRouter<Weight, Graph>::Builder::Build() {
+        using PriorityItem = std::pair<int64_t, VertexId>;
+        std::priority_queue<PriorityItem, std::vector<PriorityItem>, std::greater<PriorityItem>> queue;
+        for (VertexId vertex = 0; vertex < graph_.GetVertexCount(); ++vertex) {
+            queue.push({ GetPriority(vertex), vertex });
+        }
+
+        size_t rank = 0;
+        while (!queue.empty()) {
+            const VertexId vertex = queue.top().second;
+            queue.pop();
+            if (contracted_[vertex]) {
+                continue;
+            }
+            // Ленивое обновление: приоритет мог вырасти после стягивания соседей
+            const int64_t priority = GetPriority(vertex);
+            if (!queue.empty() && priority > queue.top().first) {
+                queue.push({ priority, vertex });
+                continue;
+            }
+            Contract(vertex, rank++);
+        }
+        return Hierarchy{ std::move(ranks_), std::move(shortcuts_) };
+    }
+
+    template <typename Weight, typename Graph>
+    std::vector<typename ContractionHierarchyRouter<Weight, Graph>::Builder::Arc>
+        ContractionHierarchyRouter<Weight, Graph>::Builder::GetNearestArcs(std::vector<Arc> arcs, VertexId exclude) {
+        // Из параллельных дуг к одной вершине достаточно самой лёгкой
+        std::sort(arcs.begin(), arcs.end(), [](const Arc& lhs, const Arc& rhs) {
+            return lhs.vertex < rhs.vertex || (lhs.vertex == rhs.vertex && lhs.weight < rhs.weight);
+        });
+        arcs.erase(std::unique(arcs.begin(), arcs.end(), [](const Arc& lhs, const Arc& rhs) {
+            return lhs.vertex == rhs.vertex;
+        }), arcs.end());
+        arcs.erase(std::remove_if(arcs.begin(), arcs.end(), [exclude](const Arc& arc) {
+            return arc.vertex == exclude;
+        }), arcs.end());
+        return arcs;
+    }
+
+    template <typename Weight, typename Graph>
+    void ContractionHierarchyRouter<Weight, Graph>::Builder::RunWitnessSearch(VertexId from, VertexId exclude, Weight limit) {
+        for (VertexId vertex : witness_touched_) {
+            witness_weights_[vertex].reset();
+        }
+        witness_touched_.clear();
+
+        Queue queue;
+        witness_weights_[from] = ZERO_WEIGHT;
+        witness_touched_.push_back(from);
+        queue.push({ ZERO_WEIGHT, from });
+
+        for (size_t settled = 0; !queue.empty() && settled < WITNESS_SETTLED_LIMIT; ++settled) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (*witness_weights_[vertex] < weight) {
+                continue;
+            }
+            if (limit < weight) {
+                break;
+            }
+            for (const Arc& arc : out_arcs_[vertex]) {
+                if (arc.vertex == exclude) {
+                    continue;
+                }
+                const Weight candidate_weight = weight + arc.weight;
+                auto& weight_to = witness_weights_[arc.vertex];
+                if (!weight_to) {
+                    witness_touched_.push_back(arc.vertex);
+                }
+                if (!weight_to || candidate_weight < *weight_to) {
+                    weight_to = candidate_weight;
+                    queue.push({ candidate_weight, arc.vertex });
+                }
+            }
+        }
+    }
+
+    template <typename Weight, typename Graph>
+    std::vector<typename ContractionHierarchyRouter<Weight, Graph>::Shortcut>
+        ContractionHierarchyRouter<Weight, Graph>::Builder::FindShortcuts(VertexId vertex) {
+        const std::vector<Arc> in_arcs = GetNearestArcs(in_arcs_[vertex], vertex);
+        const std::vector<Arc> out_arcs = GetNearestArcs(out_arcs_[vertex], vertex);
+
+        std::vector<Shortcut> shortcuts;
+        if (out_arcs.empty()) {
+            return shortcuts;
+        }
+        for (const Arc& in_arc : in_arcs) {
+            Weight limit = ZERO_WEIGHT;
+            for (const Arc& out_arc : out_arcs) {
+                limit = std::max(limit, in_arc.weight + out_arc.weight);
+            }
+            RunWitnessSearch(in_arc.vertex, vertex, limit);
+
+            for (const Arc& out_arc : out_arcs) {
+                if (out_arc.vertex == in_arc.vertex) {
+                    continue;
+                }
+                const Weight weight = in_arc.weight + out_arc.weight;
+                const auto& witness_weight = witness_weights_[out_arc.vertex];
+                if (witness_weight && !(weight < *witness_weight)) {
+                    continue;
+                }
+                shortcuts.push_back({ in_arc.vertex, out_arc.vertex, weight, in_arc.edge, out_arc.edge });
+            }
+        }
+        return shortcuts;
+    }
+
+    template <typename Weight, typename Graph>
+    int64_t ContractionHierarchyRouter<Weight, Graph>::Builder::GetPriority(VertexId vertex) {
+        // Разность рёбер: сколько сокращений добавится против числа убираемых дуг,
+        // плюс число уже стянутых соседей для равномерности стягивания
+        const int64_t shortcut_count = static_cast<int64_t>(FindShortcuts(vertex).size());
+        const int64_t arc_count = static_cast<int64_t>(in_arcs_[vertex].size() + out_arcs_[vertex].size());
+        return shortcut_count - arc_count + contracted_neighbors_[vertex];
+    }
+
+    template <typename Weight, typename Graph>
+    void ContractionHierarchyRouter<Weight, Graph>::Builder::Contract(VertexId vertex, size_t rank) {
+        const std::vector<Shortcut> shortcuts = FindShortcuts(vertex);
+        for (const Shortcut& shortcut : shortcuts) {
+            const EdgeId edge_id = graph_.GetEdgeCount() + shortcuts_.size();
+            out_arcs_[shortcut.from].push_back({ shortcut.to, shortcut.weight, edge_id });
+            in_arcs_[shortcut.to].push_back({ shortcut.from, shortcut.weight, edge_id });
+            shortcuts_.push_back(shortcut);
+        }
+
+        auto points_to_vertex = [vertex](const Arc& arc) {
+            return arc.vertex == vertex;
+        };
+        for (const Arc& arc : in_arcs_[vertex]) {
+            auto& arcs = out_arcs_[arc.vertex];
+            arcs.erase(std::remove_if(arcs.begin(), arcs.end(), points_to_vertex), arcs.end());
+            ++contracted_neighbors_[arc.vertex];
+        }
+        for (const Arc& arc : out_arcs_[vertex]) {
+            auto& arcs = in_arcs_[arc.vertex];
+            arcs.erase(std::remove_if(arcs.begin(), arcs.end(), points_to_vertex), arcs.end());
+            ++contracted_neighbors_[arc.vertex];
+        }
+        in_arcs_[vertex].clear();
+        in_arcs_[vertex].shrink_to_fit();
+        out_arcs_[vertex].clear();
+        out_arcs_[vertex].shrink_to_fit();
+
+        contracted_[vertex] = true;
+        ranks_[vertex] = rank;
+    }
+
+    template <typename Weight, typename Graph>
+    ContractionHierarchyRouter<Weight, Graph>::ContractionHierarchyRouter(const Graph& graph)
+        : ContractionHierarchyRouter(graph, Builder(graph).Build())
+    {
+    }
+
+    template <typename Weight, typename Graph>
+    ContractionHierarchyRouter<Weight, Graph>::ContractionHierarchyRouter(const Graph& graph, Hierarchy hierarchy)
+        : graph_(graph)
+        , hierarchy_(std::move(hierarchy))
+    {
+        const size_t vertex_count = graph.GetVertexCount();
+        if (hierarchy_.ranks.size() != vertex_count) {
+            throw std::invalid_argument("Contraction hierarchy doesn't match graph");
+        }
+        std::vector<bool> rank_used(vertex_count);
+        for (size_t rank : hierarchy_.ranks) {
+            if (rank >= vertex_count || rank_used[rank]) {
+                throw std::invalid_argument("Contraction hierarchy ranks are not a permutation");
+            }
+            rank_used[rank] = true;
+        }
+        for (size_t i = 0; i < hierarchy_.shortcuts.size(); ++i) {
+            const Shortcut& shortcut = hierarchy_.shortcuts[i];
+            const EdgeId edge_id = graph.GetEdgeCount() + i;
+            if (shortcut.from >= vertex_count || shortcut.to >= vertex_count
+                || shortcut.first >= edge_id || shortcut.second >= edge_id) {
+                throw std::invalid_argument("Contraction hierarchy shortcut is invalid");
+            }
+        }
+        BuildSearchGraph();
+    }
+
+    template <typename Weight, typename Graph>
+    ContractionHierarchyRouter<Weight, Graph>::ContractionHierarchyRouter(const Graph& graph, Hierarchy hierarchy,
+        SearchGraph search_graph)
+        : graph_(graph)
+        , hierarchy_(std::move(hierarchy))
+        , search_graph_(std::move(search_graph))
+    {
+        const size_t vertex_count = graph.GetVertexCount();
+        if (hierarchy_.ranks.size() != vertex_count
+            || search_graph_.upward_offsets.size() != vertex_count + 1
+            || search_graph_.downward_offsets.size() != vertex_count + 1
+            || search_graph_.upward_offsets.back() != search_graph_.upward_edges.size()
+            || search_graph_.downward_offsets.back() != search_graph_.downward_edges.size()) {
+            throw std::invalid_argument("Contraction hierarchy doesn't match graph");
+        }
+    }
+
+    template <typename Weight, typename Graph>
+    typename ContractionHierarchyRouter<Weight, Graph>::EdgeData ContractionHierarchyRouter<Weight, Graph>::GetEdgeData(EdgeId edge_id) const {
+        EdgeData data;
+        if (edge_id < graph_.GetEdgeCount()) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            data = { edge.from, edge.to, edge.weight };
+        }
+        else if (edge_id - graph_.GetEdgeCount() < hierarchy_.shortcuts.size()) {
+            const Shortcut& shortcut = hierarchy_.shortcuts[edge_id - graph_.GetEdgeCount()];
+            data = { shortcut.from, shortcut.to, shortcut.weight };
+        }
+        else {
+            throw std::invalid_argument("Contraction hierarchy edge id out of range");
+        }
+        if (data.from >= graph_.GetVertexCount() || data.to >= graph_.GetVertexCount() || data.weight < ZERO_WEIGHT) {
+            throw std::invalid_argument("Contraction hierarchy edge is invalid");
+        }
+        return data;
+    }
+
+    template <typename Weight, typename Graph>
+    void ContractionHierarchyRouter<Weight, Graph>::BuildSearchGraph() {
+        // Сортировка подсчётом по вершине сохраняет порядок id рёбер в каждом списке
+        const size_t vertex_count = graph_.GetVertexCount();
+        const EdgeId edge_count = graph_.GetEdgeCount() + hierarchy_.shortcuts.size();
+        std::vector<size_t> upward_offsets(vertex_count + 1, 0);
+        std::vector<size_t> downward_offsets(vertex_count + 1, 0);
+        for (EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+            const EdgeData edge = GetEdgeData(edge_id);
+            if (hierarchy_.ranks[edge.from] < hierarchy_.ranks[edge.to]) {
+                ++upward_offsets[edge.from + 1];
+            }
+            else if (hierarchy_.ranks[edge.to] < hierarchy_.ranks[edge.from]) {
+                ++downward_offsets[edge.to + 1];
+            }
+        }
+        for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
+            upward_offsets[vertex + 1] += upward_offsets[vertex];
+            downward_offsets[vertex + 1] += downward_offsets[vertex];
+        }
+
+        std::vector<EdgeId> upward_edges(upward_offsets.back());
+        std::vector<EdgeId> downward_edges(downward_offsets.back());
+        std::vector<size_t> upward_positions(upward_offsets.begin(), upward_offsets.end() - 1);
+        std::vector<size_t> downward_positions(downward_offsets.begin(), downward_offsets.end() - 1);
+        for (EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+            const EdgeData edge = GetEdgeData(edge_id);
+            if (hierarchy_.ranks[edge.from] < hierarchy_.ranks[edge.to]) {
+                upward_edges[upward_positions[edge.from]++] = edge_id;
+            }
+            else if (hierarchy_.ranks[edge.to] < hierarchy_.ranks[edge.from]) {
+                downward_edges[downward_positions[edge.to]++] = edge_id;
+            }
+        }
+        search_graph_ = SearchGraph{
+            std::move(upward_offsets), std::move(upward_edges), std::move(downward_offsets), std::move(downward_edges) };
+    }
+
+    template <typename Weight, typename Graph>
+    ranges::Range<const EdgeId*> ContractionHierarchyRouter<Weight, Graph>::GetSearchEdges(VertexId vertex, bool forward) const {
+        const auto& offsets = forward ? search_graph_.upward_offsets : search_graph_.downward_offsets;
+        const auto& edges = forward ? search_graph_.upward_edges : search_graph_.downward_edges;
+        const size_t begin = offsets[vertex];
+        const size_t end = offsets[vertex + 1];
+        if (begin > end || end > edges.size()) {
+            throw std::invalid_argument("Contraction hierarchy search graph is inconsistent");
+        }
+        return { edges.data() + begin, edges.data() + end };
+    }
+
+    template <typename Weight, typename Graph>
+    void ContractionHierarchyRouter<Weight, Graph>::UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& edges) const {
+        std::vector<EdgeId> stack{ edge_id };
+        while (!stack.empty()) {
+            const EdgeId id = stack.back();
+            stack.pop_back();
+            if (id < graph_.GetEdgeCount()) {
+                edges.push_back(id);
+                continue;
+            }
+            const Shortcut& shortcut = hierarchy_.shortcuts[id - graph_.GetEdgeCount()];
+            // Части сокращения построены раньше него; иначе разворачивание могло бы не закончиться
+            if (shortcut.first >= id || shortcut.second >= id) {
+                throw std::invalid_argument("Contraction hierarchy shortcut is invalid");
+            }
+            stack.push_back(shortcut.second);
+            stack.push_back(shortcut.first);
+        }
+    }
+
+    template <typename Weight, typename Graph>
+    void ContractionHierarchyRouter<Weight, Graph>::SearchState::Reset(size_t vertex_count) {
+        for (VertexId vertex : touched) {
+            weights[vertex].reset();
+            prev_edges[vertex].reset();
+        }
+        touched.clear();
+        queue.clear();
+        if (weights.size() < vertex_count) {
+            weights.resize(vertex_count);
+            prev_edges.resize(vertex_count);
+        }
+    }
+
+    template <typename Weight, typename Graph>
+    void ContractionHierarchyRouter<Weight, Graph>::SearchState::Push(VertexId vertex, Weight weight, std::optional<EdgeId> prev_edge) {
+        if (!weights[vertex]) {
+            touched.push_back(vertex);
+        }
+        weights[vertex] = weight;
+        prev_edges[vertex] = prev_edge;
+        queue.push_back({ weight, vertex });
+        std::push_heap(queue.begin(), queue.end(), std::greater<QueueItem>{});
+    }
+
+    template <typename Weight, typename Graph>
+    typename ContractionHierarchyRouter<Weight, Graph>::QueueItem ContractionHierarchyRouter<Weight, Graph>::SearchState::Pop() {
+        std::pop_heap(queue.begin(), queue.end(), std::greater<QueueItem>{});
+        const QueueItem item = queue.back();
+        queue.pop_back();
+        return item;
+    }
+
+    template <typename Weight, typename Graph>
+    std::optional<typename ContractionHierarchyRouter<Weight, Graph>::RouteInfo>
+        ContractionHierarchyRouter<Weight, Graph>::BuildRoute(VertexId from, VertexId to) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (from >= vertex_count || to >= vertex_count) {
+            throw std::out_of_range("BuildRoute: vertex id out of range");
+        }
+
+        // Свои массивы у каждого потока, так что параллельные запросы к одному роутеру не мешают друг другу
+        thread_local SearchState forward_state;
+        thread_local SearchState backward_state;
+        forward_state.Reset(vertex_count);
+        backward_state.Reset(vertex_count);
+        const auto& forward_edges = forward_state.prev_edges;
+        const auto& backward_edges = backward_state.prev_edges;
+
+        forward_state.Push(from, ZERO_WEIGHT, std::nullopt);
+        backward_state.Push(to, ZERO_WEIGHT, std::nullopt);
+
+        std::optional<Weight> best_weight;
+        VertexId meeting_vertex = from;
+
+        // Вершина с минимальным весом лежит в начале кучи
+        auto is_done = [&best_weight](const SearchState& state) {
+            return state.queue.empty() || (best_weight && !(state.queue.front().first < *best_weight));
+        };
+
+        while (!is_done(forward_state) || !is_done(backward_state)) {
+            const bool forward = !is_done(forward_state)
+                && (is_done(backward_state) || !(backward_state.queue.front().first < forward_state.queue.front().first));
+            SearchState& state = forward ? forward_state : backward_state;
+            const auto& weights = state.weights;
+            const auto& other_weights = forward ? backward_state.weights : forward_state.weights;
+
+            const auto [weight, vertex] = state.Pop();
+            if (*weights[vertex] < weight) {
+                continue;
+            }
+            if (other_weights[vertex]) {
+                const Weight candidate_weight = weight + *other_weights[vertex];
+                if (!best_weight || candidate_weight < *best_weight) {
+                    best_weight = candidate_weight;
+                    meeting_vertex = vertex;
+                }
+            }
+
+            for (const EdgeId edge_id : GetSearchEdges(vertex, forward)) {
+                const EdgeData edge = GetEdgeData(edge_id);
+                const VertexId next = forward ? edge.to : edge.from;
+                const Weight candidate_weight = weight + edge.weight;
+                const auto& weight_next = weights[next];
+                if (!weight_next || candidate_weight < *weight_next) {
+                    state.Push(next, candidate_weight, edge_id);
+                }
+            }
+        }
+
+        if (!best_weight) {
+            return std::nullopt;
+        }
+
+        std::vector<EdgeId> upward_path;
+        for (std::optional<EdgeId> edge_id = forward_edges[meeting_vertex];
+            edge_id;
+            edge_id = forward_edges[GetEdgeData(*edge_id).from])
+        {
+            upward_path.push_back(*edge_id);
+        }
+
+        std::vector<EdgeId> edges;
+        for (auto it = upward_path.rbegin(); it != upward_path.rend(); ++it) {
+            UnpackEdge(*it, edges);
+        }
+        for (std::optional<EdgeId> edge_id = backward_edges[meeting_vertex];
+            edge_id;
+            edge_id = backward_edges[GetEdgeData(*edge_id).to])
+        {
+            UnpackEdge(*edge_id, edges);
+        }
+
+        return RouteInfo{ *best_weight, std::move(edges) };
+    }
+
+    template <typename Weight, typename Graph>
+    const typename ContractionHierarchyRouter<Weight, Graph>::Hierarchy& ContractionHierarchyRouter<Weight, Graph>::GetHierarchy() const {
+        return hierarchy_;
+    }
+
+    template <typename Weight, typename Graph>
+    const typename ContractionHierarchyRouter<Weight, Graph>::SearchGraph& ContractionHierarchyRouter<Weight, Graph>::GetSearchGraph() const {
+        return search_graph_;
+    }
+
+}  // namespace graph
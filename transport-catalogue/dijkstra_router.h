@@ -0,0 +1,103 @@
+#pragma once
+
+#include "router.h"
+
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    // Ищет маршрут по запросу алгоритмом Дейкстры с бинарной кучей.
+    // В отличие от Router ничего не предвычисляет: память O(V + E) на запрос,
+    // поэтому подходит для графов, где таблица V x V не помещается в память.
+    // Граф может лежать в отображённой в память базе, поэтому веса и id рёбер проверяются
+    // по ходу поиска, а не при создании.
+    template <typename Weight, typename Graph = DirectedWeightedGraph<Weight>>
+    class DijkstraRouter {
+    public:
+        using RouteInfo = graph::RouteInfo<Weight>;
+
+        explicit DijkstraRouter(const Graph& graph);
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    private:
+        using QueueItem = std::pair<Weight, VertexId>;
+
+        static constexpr Weight ZERO_WEIGHT{};
+        const Graph& graph_;
+    };
+
+    template <typename Weight, typename Graph>
+    DijkstraRouter<Weight, Graph>::DijkstraRouter(const Graph& graph)
+        : graph_(graph)
+    {
+    }
+
+    template <typename Weight, typename Graph>
+    std::optional<typename DijkstraRouter<Weight, Graph>::RouteInfo> DijkstraRouter<Weight, Graph>::BuildRoute(VertexId from,
+        VertexId to) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (from >= vertex_count || to >= vertex_count) {
+            throw std::out_of_range("BuildRoute: vertex id out of range");
+        }
+
+        std::vector<std::optional<Weight>> weights(vertex_count);
+        std::vector<std::optional<EdgeId>> prev_edges(vertex_count);
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+
+        weights[from] = ZERO_WEIGHT;
+        queue.push({ ZERO_WEIGHT, from });
+
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (*weights[vertex] < weight) {
+                continue;
+            }
+            if (vertex == to) {
+                break;
+            }
+            for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+                if (edge_id >= graph_.GetEdgeCount()) {
+                    throw std::invalid_argument("Graph edge id out of range");
+                }
+                const auto& edge = graph_.GetEdge(edge_id);
+                if (edge.from != vertex || edge.to >= vertex_count) {
+                    throw std::invalid_argument("Graph edge doesn't match incidence list");
+                }
+                if (edge.weight < ZERO_WEIGHT) {
+                    throw std::domain_error("Edges' weights should be non-negative");
+                }
+                const Weight candidate_weight = weight + edge.weight;
+                auto& weight_to = weights[edge.to];
+                if (!weight_to || candidate_weight < *weight_to) {
+                    weight_to = candidate_weight;
+                    prev_edges[edge.to] = edge_id;
+                    queue.push({ candidate_weight, edge.to });
+                }
+            }
+        }
+
+        if (!weights[to]) {
+            return std::nullopt;
+        }
+
+        std::vector<EdgeId> edges;
+        for (std::optional<EdgeId> edge_id = prev_edges[to];
+            edge_id;
+            edge_id = prev_edges[graph_.GetEdge(*edge_id).from])
+        {
+            edges.push_back(*edge_id);
+        }
+        std::reverse(edges.begin(), edges.end());
+
+        return RouteInfo{ *weights[to], std::move(edges) };
+    }
+
+}  // namespace graph
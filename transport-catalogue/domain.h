@@ -1,6 +1,5 @@
 #pragma once
 #include <string>
-#include <list>
 #include <unordered_set>
 
 #include "geo.h"
@@ -8,15 +7,25 @@ namespace transport {
 	struct Stop {
 		std::string name_;
 		geo::Coordinates coordinates_;
+		size_t id_ = 0; // индекс в каталоге, он же вершина графа маршрутизатора
 	};
 
-	using ConteinerOfStopPointers = std::list<Stop*>;
-
 	struct Bus {
 		std::string name_;
 		bool circular_;
-		ConteinerOfStopPointers stops_;
+		// Остановки маршрута лежат подряд в общем для всех автобусов массиве id каталога,
+		// см. TransportCatalogue::GetBusStopIds
+		size_t stops_offset_ = 0;
+		size_t stops_count_ = 0;
 		std::unordered_set<Stop*> stops_set_;
+		size_t id_ = 0; // индекс в каталоге
+	};
+
+	struct BusStat {
+		size_t route_length;
+		double curvature;
+		size_t stop_count;
+		size_t unique_stop_count;
 	};
 
 	double ComputeDistance(const Stop*, const Stop*);
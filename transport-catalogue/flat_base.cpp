@@ -0,0 +1,726 @@
+#include "flat_base.h"
+#include "serialization.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TRANSPORT_FLAT_BASE_MMAP
+#endif
+
+namespace transport {
+namespace flat {
+
+static constexpr char MAGIC[8] = { 'T', 'C', 'F', 'L', 'A', 'T', '\0', '\0' };
+static constexpr uint32_t VERSION = 7;
+static constexpr uint32_t ENDIAN_CHECK = 0x01020304;
+static constexpr size_t ALIGNMENT = 8;
+
+struct FileHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t endian_check;
+	// sizeof(size_t): массивы графа, маршрутизатора и индекса остановок хранятся в том же виде, что и в памяти
+	uint64_t word_size;
+
+	uint64_t strings_offset;
+	uint64_t strings_size;
+
+	uint64_t stops_offset;
+	uint64_t stop_count;
+	uint64_t road_offsets_offset;// stop_count + 1 элементов
+	uint64_t road_distances_offset;
+	uint64_t road_distance_count;
+
+	uint64_t buses_offset;
+	uint64_t bus_count;
+	uint64_t bus_stops_offset;
+	uint64_t bus_stop_count;
+	uint64_t stop_buses_offsets_offset;// stop_count + 1 элементов
+	uint64_t stop_buses_offset;
+	uint64_t stop_bus_count;
+
+	uint64_t stop_index_offset;
+	uint64_t stop_index_size;
+	uint64_t bus_index_offset;
+	uint64_t bus_index_size;
+
+	uint64_t vertex_count;
+	uint64_t edges_offset;// graph::Edge
+	uint64_t edge_count;
+	uint64_t incidence_offsets_offset;// vertex_count + 1 элементов
+	uint64_t incidence_offset;// edge_count элементов
+	uint64_t edge_infos_offset;// router::EdgeInfo
+	uint64_t routes_offset;
+	uint64_t routes_count;
+	uint64_t route_weights_offset;// routes_count элементов
+	uint64_t ranks_offset;// vertex_count элементов, если есть иерархия сокращений
+	uint64_t shortcuts_offset;
+	uint64_t shortcut_count;
+	// Граф поиска по иерархии сокращений
+	uint64_t upward_offsets_offset;// vertex_count + 1 элементов
+	uint64_t upward_edges_offset;
+	uint64_t upward_edge_count;
+	uint64_t downward_offsets_offset;// vertex_count + 1 элементов
+	uint64_t downward_edges_offset;
+	uint64_t downward_edge_count;
+
+	double bus_wait_time;
+	double bus_velocity;
+	uint64_t engine;
+
+	uint64_t render_settings_offset;
+	uint64_t render_settings_size;
+
+	uint64_t map_offset;// SVG карты, отрисованной при make_base
+	uint64_t map_size;
+
+	// Сетка StopIndex над координатами остановок
+	double stop_grid_min_lat;
+	double stop_grid_min_lng;
+	double stop_grid_cell_lat;
+	double stop_grid_cell_lng;
+	uint64_t stop_grid_rows;
+	uint64_t stop_grid_columns;
+	uint64_t stop_grid_offsets_offset;// stop_grid_rows * stop_grid_columns + 1 элементов
+	uint64_t stop_grid_ids_offset;// stop_count элементов
+	uint64_t stop_grid_points_offset;// stop_count элементов geo::PreparedCoordinates
+};
+
+using Shortcut = graph::ContractionHierarchyRouter<router::Time, router::DirectedGraph>::Shortcut;
+
+static uint64_t HashName(std::string_view name) {
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+	for (char c : name) {
+		hash ^= static_cast<unsigned char>(c);
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+static size_t GetIndexSize(size_t count) {
+	size_t ret = 1;
+	while (ret < count * 2) {
+		ret <<= 1;
+	}
+	return ret;
+}
+
+// Открытая адресация с линейным пробированием: в ячейке id + 1, 0 — пусто
+template <typename GetName>
+static std::vector<uint32_t> BuildIndex(size_t count, GetName get_name) {
+	std::vector<uint32_t> index(GetIndexSize(count));
+	const size_t mask = index.size() - 1;
+	for (size_t id = 0; id < count; ++id) {
+		size_t pos = HashName(get_name(id)) & mask;
+		while (index[pos]) {
+			pos = (pos + 1) & mask;
+		}
+		index[pos] = static_cast<uint32_t>(id + 1);
+	}
+	return index;
+}
+
+class Writer {
+public:
+	Writer() : data_(sizeof(FileHeader), '\0') {}
+
+	// Массив (std::vector или ranges::Storage) записывается байт в байт, как лежит в памяти
+	template <typename Container>
+	uint64_t Append(const Container& items) {
+		return Append(items.data(), items.size() * sizeof(*items.data()));
+	}
+
+	uint64_t Append(const void* data, size_t size) {
+		data_.resize((data_.size() + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT, '\0');
+		uint64_t offset = data_.size();
+		data_.append(static_cast<const char*>(data), size);
+		return offset;
+	}
+
+	void Write(const FileHeader& header, std::ostream& output) {
+		std::memcpy(data_.data(), &header, sizeof(header));
+		output.write(data_.data(), static_cast<std::streamsize>(data_.size()));
+	}
+
+private:
+	std::string data_;
+};
+
+bool IsFlatBase(const std::filesystem::path& path) {
+	std::ifstream file(path, std::ios::binary);
+	char magic[sizeof(MAGIC)]{};
+	return file.read(magic, sizeof(magic)) && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+void SaveBaseTo(
+	const TransportCatalogue& transport_catalogue,
+	const renderer::RenderSettings& render_settings,
+	const router::Router& router,
+	const std::string& map,
+	std::ostream& output,
+	bool store_routes) {
+
+	FileHeader header{};
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.endian_check = ENDIAN_CHECK;
+	header.word_size = sizeof(size_t);
+
+	Writer writer;
+	std::string strings;
+	auto add_string = [&strings](std::string_view str) {
+		uint32_t offset = static_cast<uint32_t>(strings.size());
+		strings.append(str);
+		return offset;
+	};
+
+	const auto& stops = transport_catalogue.GetStops();
+	std::vector<StopRecord> stop_records;
+	stop_records.reserve(stops.size());
+	for (const Stop& stop : stops) {
+		stop_records.push_back({
+			add_string(stop.name_), static_cast<uint32_t>(stop.name_.size()),
+			stop.coordinates_.lat, stop.coordinates_.lng });
+	}
+
+	std::vector<std::vector<RoadDistanceRecord>> distances_from(stops.size());
+	transport_catalogue.GetRoadDistances().ForEach([&distances_from](size_t from, size_t to, size_t length) {
+		distances_from[from].push_back({ static_cast<uint32_t>(to), static_cast<uint32_t>(length) });
+	});
+	std::vector<uint32_t> road_offsets{ 0 };
+	std::vector<RoadDistanceRecord> road_distances;
+	for (auto& distances : distances_from) {
+		std::sort(distances.begin(), distances.end(), [](const auto& lhs, const auto& rhs) {
+			return lhs.to < rhs.to;
+		});
+		road_distances.insert(road_distances.end(), distances.begin(), distances.end());
+		road_offsets.push_back(static_cast<uint32_t>(road_distances.size()));
+	}
+
+	const auto& buses = transport_catalogue.GetBuses();
+	std::vector<BusRecord> bus_records;
+	std::vector<uint32_t> bus_stops;
+	bus_records.reserve(buses.size());
+	for (const Bus& bus : buses) {
+		BusRecord record{};
+		record.name_offset = add_string(bus.name_);
+		record.name_size = static_cast<uint32_t>(bus.name_.size());
+		record.stops_offset = static_cast<uint32_t>(bus_stops.size());
+		record.stops_count = static_cast<uint32_t>(bus.stops_count_);
+		record.circular = bus.circular_;
+		const BusStat stat = transport_catalogue.GetBusStat(&bus);
+		record.stop_count = static_cast<uint32_t>(stat.stop_count);
+		record.unique_stop_count = static_cast<uint32_t>(stat.unique_stop_count);
+		record.route_length = stat.route_length;
+		record.curvature = stat.curvature;
+		for (size_t stop_id : transport_catalogue.GetBusStopIds(&bus)) {
+			bus_stops.push_back(static_cast<uint32_t>(stop_id));
+		}
+		bus_records.push_back(record);
+	}
+
+	std::vector<uint32_t> stop_buses_offsets{ 0 };
+	std::vector<uint32_t> stop_buses;
+	std::vector<const Bus*> buses_of_stop;
+	for (const Stop& stop : stops) {
+		const auto* stop_buses_set = transport_catalogue.GetBusesByStop(&stop);
+		buses_of_stop.assign(stop_buses_set->begin(), stop_buses_set->end());
+		std::sort(buses_of_stop.begin(), buses_of_stop.end(), [](const Bus* lhs, const Bus* rhs) {
+			return lhs->name_ < rhs->name_;
+		});
+		for (const Bus* bus : buses_of_stop) {
+			stop_buses.push_back(static_cast<uint32_t>(bus->id_));
+		}
+		stop_buses_offsets.push_back(static_cast<uint32_t>(stop_buses.size()));
+	}
+
+	std::vector<uint32_t> stop_index = BuildIndex(stops.size(), [&stops](size_t id) {
+		return std::string_view{ stops[id].name_ };
+	});
+	std::vector<uint32_t> bus_index = BuildIndex(buses.size(), [&buses](size_t id) {
+		return std::string_view{ buses[id].name_ };
+	});
+
+	const router::Graph& router_graph = router.GetGraph();
+	const auto& directed_graph = router_graph.directed_weighted_graph;
+	if (router_graph.edges.size() != directed_graph.GetEdgeCount()) {
+		throw std::logic_error("Router graph edges don't match edge infos");
+	}
+	const router::Router::RoutesTable* routes = store_routes ? router.GetRoutesTable() : nullptr;
+	const router::Router::ContractionHierarchy* hierarchy = router.GetContractionHierarchy();
+	const router::Router::SearchGraph* search_graph = router.GetSearchGraph();
+
+	std::string render_settings_blob = serialize::SerializeRenderSettings(render_settings).SerializeAsString();
+
+	header.strings_offset = writer.Append(strings.data(), strings.size());
+	header.strings_size = strings.size();
+	header.stops_offset = writer.Append(stop_records);
+	header.stop_count = stop_records.size();
+	header.road_offsets_offset = writer.Append(road_offsets);
+	header.road_distances_offset = writer.Append(road_distances);
+	header.road_distance_count = road_distances.size();
+	header.buses_offset = writer.Append(bus_records);
+	header.bus_count = bus_records.size();
+	header.bus_stops_offset = writer.Append(bus_stops);
+	header.bus_stop_count = bus_stops.size();
+	header.stop_buses_offsets_offset = writer.Append(stop_buses_offsets);
+	header.stop_buses_offset = writer.Append(stop_buses);
+	header.stop_bus_count = stop_buses.size();
+	header.stop_index_offset = writer.Append(stop_index);
+	header.stop_index_size = stop_index.size();
+	header.bus_index_offset = writer.Append(bus_index);
+	header.bus_index_size = bus_index.size();
+	header.vertex_count = directed_graph.GetVertexCount();
+	header.edges_offset = writer.Append(directed_graph.GetEdges());
+	header.edge_count = directed_graph.GetEdgeCount();
+	header.incidence_offsets_offset = writer.Append(directed_graph.GetOffsets());
+	header.incidence_offset = writer.Append(directed_graph.GetIncidence());
+	header.edge_infos_offset = writer.Append(router_graph.edges);
+	if (routes) {
+		header.routes_offset = writer.Append(routes->prev_edges);
+		header.routes_count = routes->prev_edges.size();
+		header.route_weights_offset = writer.Append(routes->weights);
+	}
+	if (hierarchy && search_graph) {
+		header.ranks_offset = writer.Append(hierarchy->ranks);
+		header.shortcuts_offset = writer.Append(hierarchy->shortcuts);
+		header.shortcut_count = hierarchy->shortcuts.size();
+		header.upward_offsets_offset = writer.Append(search_graph->upward_offsets);
+		header.upward_edges_offset = writer.Append(search_graph->upward_edges);
+		header.upward_edge_count = search_graph->upward_edges.size();
+		header.downward_offsets_offset = writer.Append(search_graph->downward_offsets);
+		header.downward_edges_offset = writer.Append(search_graph->downward_edges);
+		header.downward_edge_count = search_graph->downward_edges.size();
+	}
+	const router::RouterSettings& router_settings = router.GetSettings();
+	header.bus_wait_time = router_settings.bus_wait_time;
+	header.bus_velocity = router_settings.bus_velocity;
+	header.engine = static_cast<uint64_t>(router_settings.engine);
+	header.render_settings_offset = writer.Append(render_settings_blob.data(), render_settings_blob.size());
+	header.render_settings_size = render_settings_blob.size();
+	header.map_offset = writer.Append(map.data(), map.size());
+	header.map_size = map.size();
+	const StopIndex& stop_grid = transport_catalogue.GetStopIndex();
+	header.stop_grid_min_lat = stop_grid.GetGrid().min.lat;
+	header.stop_grid_min_lng = stop_grid.GetGrid().min.lng;
+	header.stop_grid_cell_lat = stop_grid.GetGrid().cell_lat;
+	header.stop_grid_cell_lng = stop_grid.GetGrid().cell_lng;
+	header.stop_grid_rows = stop_grid.GetGrid().rows;
+	header.stop_grid_columns = stop_grid.GetGrid().columns;
+	header.stop_grid_offsets_offset = writer.Append(stop_grid.GetCellOffsets());
+	header.stop_grid_ids_offset = writer.Append(stop_grid.GetStopIds());
+	header.stop_grid_points_offset = writer.Append(stop_grid.GetPoints());
+
+	writer.Write(header, output);
+}
+
+MappedBase::MappedBase(const std::filesystem::path& path) {
+#ifdef TRANSPORT_FLAT_BASE_MMAP
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("Can't open data base: " + path.string());
+	}
+	struct stat st {};
+	if (::fstat(fd, &st) != 0) {
+		::close(fd);
+		throw std::runtime_error("Can't stat data base: " + path.string());
+	}
+	size_ = static_cast<size_t>(st.st_size);
+	if (size_ != 0) {
+		void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED) {
+			::close(fd);
+			throw std::runtime_error("Can't map data base: " + path.string());
+		}
+		data_ = static_cast<const char*>(data);
+		mapped_ = true;
+	}
+	::close(fd);
+#else
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Can't open data base: " + path.string());
+	}
+	buffer_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	data_ = buffer_.data();
+	size_ = buffer_.size();
+#endif
+	try {
+		Validate();
+	}
+	catch (...) {
+		Unmap();
+		throw;
+	}
+}
+
+MappedBase::~MappedBase() {
+	Unmap();
+}
+
+void MappedBase::Unmap() {
+#ifdef TRANSPORT_FLAT_BASE_MMAP
+	if (mapped_) {
+		::munmap(const_cast<char*>(data_), size_);
+		mapped_ = false;
+	}
+#endif
+}
+
+const FileHeader& MappedBase::GetHeader() const {
+	return *reinterpret_cast<const FileHeader*>(data_);
+}
+
+template <typename T>
+const T* MappedBase::Section(uint64_t offset, uint64_t count) const {
+	if (offset % alignof(T) != 0 || offset > size_ || count > (size_ - offset) / sizeof(T)) {
+		throw std::logic_error("Data base is broken: section out of bounds");
+	}
+	return reinterpret_cast<const T*>(data_ + offset);
+}
+
+template <typename T>
+ranges::Storage<T> MappedBase::GetArray(uint64_t offset, uint64_t count, bool borrow) const {
+	const T* data = Section<T>(offset, count);
+	if (borrow) {
+		return ranges::Storage<T>::Borrow(data, count);
+	}
+	return std::vector<T>(data, data + count);
+}
+
+void MappedBase::Validate() const {
+	if (size_ < sizeof(FileHeader) || std::memcmp(data_, MAGIC, sizeof(MAGIC)) != 0) {
+		throw std::logic_error("Data base is not in flat format");
+	}
+	const FileHeader& header = GetHeader();
+	if (header.version != VERSION || header.endian_check != ENDIAN_CHECK || header.word_size != sizeof(size_t)) {
+		throw std::logic_error("Data base flat format version is not supported");
+	}
+	Section<char>(header.strings_offset, header.strings_size);
+	Section<StopRecord>(header.stops_offset, header.stop_count);
+	Section<uint32_t>(header.road_offsets_offset, header.stop_count + 1);
+	Section<RoadDistanceRecord>(header.road_distances_offset, header.road_distance_count);
+	Section<BusRecord>(header.buses_offset, header.bus_count);
+	Section<uint32_t>(header.bus_stops_offset, header.bus_stop_count);
+	Section<uint32_t>(header.stop_buses_offsets_offset, header.stop_count + 1);
+	Section<uint32_t>(header.stop_buses_offset, header.stop_bus_count);
+	Section<uint32_t>(header.stop_index_offset, header.stop_index_size);
+	Section<uint32_t>(header.bus_index_offset, header.bus_index_size);
+	Section<graph::Edge<router::Time>>(header.edges_offset, header.edge_count);
+	Section<size_t>(header.incidence_offsets_offset, header.vertex_count + 1);
+	Section<graph::EdgeId>(header.incidence_offset, header.edge_count);
+	Section<router::EdgeInfo>(header.edge_infos_offset, header.edge_count);
+	if (header.routes_count) {
+		Section<uint32_t>(header.routes_offset, header.routes_count);
+		Section<router::Time>(header.route_weights_offset, header.routes_count);
+	}
+	if (header.ranks_offset) {
+		Section<size_t>(header.ranks_offset, header.vertex_count);
+		Section<Shortcut>(header.shortcuts_offset, header.shortcut_count);
+		Section<size_t>(header.upward_offsets_offset, header.vertex_count + 1);
+		Section<graph::EdgeId>(header.upward_edges_offset, header.upward_edge_count);
+		Section<size_t>(header.downward_offsets_offset, header.vertex_count + 1);
+		Section<graph::EdgeId>(header.downward_edges_offset, header.downward_edge_count);
+	}
+	Section<char>(header.render_settings_offset, header.render_settings_size);
+	Section<char>(header.map_offset, header.map_size);
+	if (header.stop_grid_rows > UINT32_MAX || header.stop_grid_columns > UINT32_MAX) {
+		throw std::logic_error("Data base is broken: stop index");
+	}
+	Section<uint32_t>(header.stop_grid_offsets_offset, header.stop_grid_rows * header.stop_grid_columns + 1);
+	Section<uint32_t>(header.stop_grid_ids_offset, header.stop_count);
+	Section<geo::PreparedCoordinates>(header.stop_grid_points_offset, header.stop_count);
+	if ((header.stop_index_size & (header.stop_index_size - 1)) != 0
+		|| (header.bus_index_size & (header.bus_index_size - 1)) != 0) {
+		throw std::logic_error("Data base is broken: invalid index size");
+	}
+}
+
+std::string_view MappedBase::GetString(uint32_t offset, uint32_t size) const {
+	const FileHeader& header = GetHeader();
+	if (offset > header.strings_size || size > header.strings_size - offset) {
+		throw std::logic_error("Data base is broken: string out of bounds");
+	}
+	return { data_ + header.strings_offset + offset, size };
+}
+
+std::optional<size_t> MappedBase::Find(std::string_view name, uint64_t index_offset, uint64_t index_size,
+	std::string_view(MappedBase::* get_name)(size_t) const) const {
+	if (index_size == 0) {
+		return std::nullopt;
+	}
+	const uint32_t* index = Section<uint32_t>(index_offset, index_size);
+	const size_t mask = index_size - 1;
+	for (size_t pos = HashName(name) & mask, probes = 0; index[pos] && probes < index_size; pos = (pos + 1) & mask, ++probes) {
+		size_t id = index[pos] - 1;
+		if ((this->*get_name)(id) == name) {
+			return id;
+		}
+	}
+	return std::nullopt;
+}
+
+size_t MappedBase::GetStopCount() const {
+	return GetHeader().stop_count;
+}
+
+std::string_view MappedBase::GetStopName(size_t stop_id) const {
+	const FileHeader& header = GetHeader();
+	if (stop_id >= header.stop_count) {
+		throw std::out_of_range("Stop id out of range");
+	}
+	const StopRecord& stop = Section<StopRecord>(header.stops_offset, header.stop_count)[stop_id];
+	return GetString(stop.name_offset, stop.name_size);
+}
+
+geo::Coordinates MappedBase::GetStopCoordinates(size_t stop_id) const {
+	const FileHeader& header = GetHeader();
+	if (stop_id >= header.stop_count) {
+		throw std::out_of_range("Stop id out of range");
+	}
+	const StopRecord& stop = Section<StopRecord>(header.stops_offset, header.stop_count)[stop_id];
+	return { stop.lat, stop.lng };
+}
+
+std::optional<size_t> MappedBase::FindStop(std::string_view name) const {
+	const FileHeader& header = GetHeader();
+	return Find(name, header.stop_index_offset, header.stop_index_size, &MappedBase::GetStopName);
+}
+
+MappedBase::RoadDistances MappedBase::GetRoadDistances(size_t stop_id) const {
+	const FileHeader& header = GetHeader();
+	if (stop_id >= header.stop_count) {
+		throw std::out_of_range("Stop id out of range");
+	}
+	const uint32_t* offsets = Section<uint32_t>(header.road_offsets_offset, header.stop_count + 1);
+	if (offsets[stop_id] > offsets[stop_id + 1] || offsets[stop_id + 1] > header.road_distance_count) {
+		throw std::logic_error("Data base is broken: road distances out of bounds");
+	}
+	const RoadDistanceRecord* distances = Section<RoadDistanceRecord>(header.road_distances_offset, header.road_distance_count);
+	return { distances + offsets[stop_id], distances + offsets[stop_id + 1] };
+}
+
+MappedBase::StopIds MappedBase::GetStopBuses(size_t stop_id) const {
+	const FileHeader& header = GetHeader();
+	if (stop_id >= header.stop_count) {
+		throw std::out_of_range("Stop id out of range");
+	}
+	const uint32_t* offsets = Section<uint32_t>(header.stop_buses_offsets_offset, header.stop_count + 1);
+	if (offsets[stop_id] > offsets[stop_id + 1] || offsets[stop_id + 1] > header.stop_bus_count) {
+		throw std::logic_error("Data base is broken: stop buses out of bounds");
+	}
+	const uint32_t* buses = Section<uint32_t>(header.stop_buses_offset, header.stop_bus_count);
+	return { buses + offsets[stop_id], buses + offsets[stop_id + 1] };
+}
+
+size_t MappedBase::GetBusCount() const {
+	return GetHeader().bus_count;
+}
+
+std::string_view MappedBase::GetBusName(size_t bus_id) const {
+	const FileHeader& header = GetHeader();
+	if (bus_id >= header.bus_count) {
+		throw std::out_of_range("Bus id out of range");
+	}
+	const BusRecord& bus = Section<BusRecord>(header.buses_offset, header.bus_count)[bus_id];
+	return GetString(bus.name_offset, bus.name_size);
+}
+
+bool MappedBase::IsBusRoundtrip(size_t bus_id) const {
+	const FileHeader& header = GetHeader();
+	if (bus_id >= header.bus_count) {
+		throw std::out_of_range("Bus id out of range");
+	}
+	return Section<BusRecord>(header.buses_offset, header.bus_count)[bus_id].circular != 0;
+}
+
+BusStat MappedBase::GetBusStat(size_t bus_id) const {
+	const FileHeader& header = GetHeader();
+	if (bus_id >= header.bus_count) {
+		throw std::out_of_range("Bus id out of range");
+	}
+	const BusRecord& bus = Section<BusRecord>(header.buses_offset, header.bus_count)[bus_id];
+	return { static_cast<size_t>(bus.route_length), bus.curvature, bus.stop_count, bus.unique_stop_count };
+}
+
+MappedBase::StopIds MappedBase::GetBusStops(size_t bus_id) const {
+	const FileHeader& header = GetHeader();
+	if (bus_id >= header.bus_count) {
+		throw std::out_of_range("Bus id out of range");
+	}
+	const BusRecord& bus = Section<BusRecord>(header.buses_offset, header.bus_count)[bus_id];
+	if (bus.stops_offset > header.bus_stop_count || bus.stops_count > header.bus_stop_count - bus.stops_offset) {
+		throw std::logic_error("Data base is broken: bus stops out of bounds");
+	}
+	const uint32_t* stops = Section<uint32_t>(header.bus_stops_offset, header.bus_stop_count) + bus.stops_offset;
+	return { stops, stops + bus.stops_count };
+}
+
+std::optional<size_t> MappedBase::FindBus(std::string_view name) const {
+	const FileHeader& header = GetHeader();
+	return Find(name, header.bus_index_offset, header.bus_index_size, &MappedBase::GetBusName);
+}
+
+TransportCatalogue MappedBase::MakeTransportCatalogue() const {
+	TransportCatalogue transport_catalogue;
+
+	const size_t stop_count = GetStopCount();
+	for (size_t stop_id = 0; stop_id < stop_count; ++stop_id) {
+		transport_catalogue.AddStop(std::string(GetStopName(stop_id)), GetStopCoordinates(stop_id));
+	}
+
+	for (size_t stop_id = 0; stop_id < stop_count; ++stop_id) {
+		for (const RoadDistanceRecord& distance : GetRoadDistances(stop_id)) {
+			transport_catalogue.SetLengthBetweenStops(stop_id, distance.to, distance.length);
+		}
+	}
+
+	std::vector<size_t> stop_ids;
+	std::vector<BusStat> bus_stats;
+	bus_stats.reserve(GetBusCount());
+	for (size_t bus_id = 0; bus_id < GetBusCount(); ++bus_id) {
+		const StopIds bus_stops = GetBusStops(bus_id);
+		stop_ids.assign(bus_stops.begin(), bus_stops.end());
+		transport_catalogue.AddBusWithStopIds(std::string(GetBusName(bus_id)), IsBusRoundtrip(bus_id), stop_ids);
+		bus_stats.push_back(GetBusStat(bus_id));
+	}
+	transport_catalogue.SetBusStats(std::move(bus_stats));
+
+	const FileHeader& header = GetHeader();
+	const size_t cell_count = header.stop_grid_rows * header.stop_grid_columns;
+	const uint32_t* cell_offsets = Section<uint32_t>(header.stop_grid_offsets_offset, cell_count + 1);
+	const uint32_t* grid_stop_ids = Section<uint32_t>(header.stop_grid_ids_offset, stop_count);
+	transport_catalogue.SetStopIndex(GetStopGrid(), { cell_offsets, cell_offsets + cell_count + 1 },
+		{ grid_stop_ids, grid_stop_ids + stop_count });
+	return transport_catalogue;
+}
+
+StopIndex::Grid MappedBase::GetStopGrid() const {
+	const FileHeader& header = GetHeader();
+	StopIndex::Grid grid;
+	grid.min = { header.stop_grid_min_lat, header.stop_grid_min_lng };
+	grid.cell_lat = header.stop_grid_cell_lat;
+	grid.cell_lng = header.stop_grid_cell_lng;
+	grid.rows = static_cast<uint32_t>(header.stop_grid_rows);
+	grid.columns = static_cast<uint32_t>(header.stop_grid_columns);
+	return grid;
+}
+
+StopIndex MappedBase::MakeStopIndexView() const {
+	const FileHeader& header = GetHeader();
+	const size_t cell_count = header.stop_grid_rows * header.stop_grid_columns;
+	return StopIndex(
+		GetArray<geo::PreparedCoordinates>(header.stop_grid_points_offset, header.stop_count, true),
+		GetStopGrid(),
+		GetArray<uint32_t>(header.stop_grid_offsets_offset, cell_count + 1, true),
+		GetArray<uint32_t>(header.stop_grid_ids_offset, header.stop_count, true));
+}
+
+renderer::RenderSettings MappedBase::GetRenderSettings() const {
+	const FileHeader& header = GetHeader();
+	serialize::RenderSettings render_settings;
+	if (!render_settings.ParseFromArray(
+		Section<char>(header.render_settings_offset, header.render_settings_size),
+		static_cast<int>(header.render_settings_size))) {
+		throw std::logic_error("Data base is broken: render settings");
+	}
+	return serialize::DeserializeRenderSettings(render_settings);
+}
+
+std::string_view MappedBase::GetMap() const {
+	const FileHeader& header = GetHeader();
+	return { Section<char>(header.map_offset, header.map_size), header.map_size };
+}
+
+router::Router MappedBase::MakeRouter() const {
+	return BuildRouter(false);
+}
+
+bool MappedBase::HasStoredRoutes() const {
+	return GetHeader().routes_count != 0;
+}
+
+router::Router MappedBase::MakeRouterView() const {
+	return BuildRouter(true);
+}
+
+router::Router MappedBase::BuildRouter(bool borrow) const {
+	const FileHeader& header = GetHeader();
+
+	router::Graph router_graph{
+		router::DirectedGraph{
+			GetArray<graph::Edge<router::Time>>(header.edges_offset, header.edge_count, borrow),
+			GetArray<size_t>(header.incidence_offsets_offset, header.vertex_count + 1, borrow),
+			GetArray<graph::EdgeId>(header.incidence_offset, header.edge_count, borrow) },
+		GetArray<router::EdgeInfo>(header.edge_infos_offset, header.edge_count, borrow)
+	};
+
+	router::RouterSettings settings;
+	settings.bus_wait_time = header.bus_wait_time;
+	settings.bus_velocity = header.bus_velocity;
+	switch (static_cast<router::RouterEngine>(header.engine)) {
+	case router::RouterEngine::DIJKSTRA:
+		settings.engine = router::RouterEngine::DIJKSTRA;
+		break;
+	case router::RouterEngine::CONTRACTION_HIERARCHY:
+		settings.engine = router::RouterEngine::CONTRACTION_HIERARCHY;
+		break;
+	default:
+		settings.engine = router::RouterEngine::ALL_PAIRS;
+		break;
+	}
+
+	if (header.ranks_offset) {
+		return router::Router(std::move(router_graph), settings,
+			router::Router::ContractionHierarchy{
+				GetArray<size_t>(header.ranks_offset, header.vertex_count, borrow),
+				GetArray<Shortcut>(header.shortcuts_offset, header.shortcut_count, borrow) },
+			router::Router::SearchGraph{
+				GetArray<size_t>(header.upward_offsets_offset, header.vertex_count + 1, borrow),
+				GetArray<graph::EdgeId>(header.upward_edges_offset, header.upward_edge_count, borrow),
+				GetArray<size_t>(header.downward_offsets_offset, header.vertex_count + 1, borrow),
+				GetArray<graph::EdgeId>(header.downward_edges_offset, header.downward_edge_count, borrow) });
+	}
+
+	if (header.routes_count) {
+		return router::Router(std::move(router_graph), settings, router::Router::RoutesTable{
+			GetArray<uint32_t>(header.routes_offset, header.routes_count, borrow),
+			GetArray<router::Time>(header.route_weights_offset, header.routes_count, borrow) });
+	}
+	return router::Router(std::move(router_graph), settings);
+}
+
+QueryBase::QueryBase(const std::filesystem::path& path)
+	: data_(path)
+	, render_settings_(data_.GetRenderSettings())
+	, router_(data_.MakeRouterView())
+	, stop_index_(data_.MakeStopIndexView()) {
+}
+
+const MappedBase& QueryBase::GetData() const {
+	return data_;
+}
+
+const renderer::RenderSettings& QueryBase::GetRenderSettings() const {
+	return render_settings_;
+}
+
+const router::Router& QueryBase::GetRouter() const {
+	return router_;
+}
+
+const StopIndex& QueryBase::GetStopIndex() const {
+	return stop_index_;
+}
+
+} // namespace flat
+} // namespace transport
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "transport_catalogue.h"
+#include "map_renderer.h"
+#include "transport_router.h"
+#include "ranges.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+namespace transport {
+namespace flat {
+
+/*
+ * Плоский бинарный формат базы, который можно отобразить в память (mmap) и читать на месте,
+ * без разбора protobuf. Все секции выровнены на 8 байт, смещения в заголовке — от начала файла.
+ *
+ * Секции: пул строк, таблица остановок, расстояния между остановками (CSR по остановке-источнику),
+ * таблица автобусов и массив id их остановок, автобусы каждой остановки (CSR, по возрастанию имени),
+ * хеш-индексы имён остановок и автобусов, граф маршрутизатора (рёбра по id и CSR списков инцидентности),
+ * описания рёбер, необязательные таблица предрасчитанных маршрутов и иерархия сокращений с графом поиска,
+ * настройки отрисовки (protobuf), готовая карта, индекс остановок по координатам.
+ * Массивы графа, маршрутизатора и индекса остановок лежат в том же виде, что и в памяти,
+ * поэтому QueryBase отвечает на запросы, не копируя их.
+ *
+ * Пока база отображена, файл нельзя менять на месте: новую базу записывают рядом и подменяют
+ * переименованием, как это делает SaveBase, и отображение продолжает видеть старую.
+ */
+
+struct StopRecord {
+	uint32_t name_offset;
+	uint32_t name_size;
+	double lat;
+	double lng;
+};
+
+struct RoadDistanceRecord {
+	uint32_t to;
+	uint32_t length;
+};
+
+struct BusRecord {
+	uint32_t name_offset;
+	uint32_t name_size;
+	uint32_t stops_offset;
+	uint32_t stops_count;
+	uint32_t circular;
+	// Предрасчитанная статистика маршрута для запроса Bus
+	uint32_t stop_count;
+	uint32_t unique_stop_count;
+	uint32_t reserved;
+	uint64_t route_length;
+	double curvature;
+};
+
+struct FileHeader;
+
+bool IsFlatBase(const std::filesystem::path& path);
+
+void SaveBaseTo(
+	const TransportCatalogue& transport_catalogue,
+	const renderer::RenderSettings& render_settings,
+	const router::Router& router,
+	const std::string& map,
+	std::ostream& output,
+	bool store_routes);
+
+class MappedBase {
+public:
+	using StopIds = ranges::Range<const uint32_t*>;
+	using RoadDistances = ranges::Range<const RoadDistanceRecord*>;
+
+	explicit MappedBase(const std::filesystem::path& path);
+	~MappedBase();
+
+	MappedBase(const MappedBase&) = delete;
+	MappedBase& operator=(const MappedBase&) = delete;
+
+	size_t GetStopCount() const;
+	std::string_view GetStopName(size_t stop_id) const;
+	geo::Coordinates GetStopCoordinates(size_t stop_id) const;
+	std::optional<size_t> FindStop(std::string_view name) const;
+	RoadDistances GetRoadDistances(size_t stop_id) const;
+	// id автобусов, проходящих через остановку, по возрастанию имени
+	StopIds GetStopBuses(size_t stop_id) const;
+
+	size_t GetBusCount() const;
+	std::string_view GetBusName(size_t bus_id) const;
+	bool IsBusRoundtrip(size_t bus_id) const;
+	StopIds GetBusStops(size_t bus_id) const;
+	BusStat GetBusStat(size_t bus_id) const;
+	std::optional<size_t> FindBus(std::string_view name) const;
+
+	// Каталог и маршрутизатор, собранные в памяти целиком, — для изменения базы
+	TransportCatalogue MakeTransportCatalogue() const;
+	renderer::RenderSettings GetRenderSettings() const;
+	std::string_view GetMap() const;
+	router::Router MakeRouter() const;
+	// Записана ли таблица предрасчитанных маршрутов (store_routes)
+	bool HasStoredRoutes() const;
+	// Маршрутизатор и индекс остановок, которые читают массивы прямо из отображения.
+	// Ссылаются на память MappedBase и не должны его пережить
+	router::Router MakeRouterView() const;
+	StopIndex MakeStopIndexView() const;
+
+private:
+	const char* data_ = nullptr;
+	size_t size_ = 0;
+	std::vector<char> buffer_;
+	bool mapped_ = false;
+
+	void Unmap();
+	const FileHeader& GetHeader() const;
+
+	template <typename T>
+	const T* Section(uint64_t offset, uint64_t count) const;
+	// Секция как массив: ссылается на отображение или копирует его
+	template <typename T>
+	ranges::Storage<T> GetArray(uint64_t offset, uint64_t count, bool borrow) const;
+	router::Router BuildRouter(bool borrow) const;
+	StopIndex::Grid GetStopGrid() const;
+
+	std::string_view GetString(uint32_t offset, uint32_t size) const;
+	std::optional<size_t> Find(std::string_view name, uint64_t index_offset, uint64_t index_size,
+		std::string_view (MappedBase::*get_name)(size_t) const) const;
+	void Validate() const;
+};
+
+// Плоская база, по которой отвечают на запросы, не собирая каталог: остановки и автобусы читаются
+// через MappedBase, маршрутизатор и индекс остановок ссылаются на отображение. Открытие не зависит
+// от размера базы, если маршрутизатору нечего считать: для ALL_PAIRS без сохранённых маршрутов
+// таблица считается заново
+class QueryBase {
+public:
+	explicit QueryBase(const std::filesystem::path& path);
+
+	const MappedBase& GetData() const;
+	const renderer::RenderSettings& GetRenderSettings() const;
+	const router::Router& GetRouter() const;
+	const StopIndex& GetStopIndex() const;
+
+private:
+	MappedBase data_;
+	renderer::RenderSettings render_settings_;
+	router::Router router_;
+	StopIndex stop_index_;
+};
+
+} // namespace flat
+} // namespace transport
@@ -1,19 +1,185 @@
 #define _USE_MATH_DEFINES
 
 #include "geo.h"
+#include <cassert>
+#include <chrono>
 #include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
 
 namespace geo {
 
+namespace {
+    constexpr double dr = M_PI / 180.;
+}
+
+PreparedCoordinates Prepare(Coordinates point) {
+    return { point, std::sin(point.lat * dr), std::cos(point.lat * dr) };
+}
+
 double ComputeDistance(Coordinates from, Coordinates to) {
+    return ComputeDistance(Prepare(from), Prepare(to));
+}
+
+double ComputeDistance(const PreparedCoordinates& from, const PreparedCoordinates& to) {
+    using namespace std;
+    if (from.coordinates == to.coordinates) {
+        return 0;
+    }
+    return acos(from.sin_lat * to.sin_lat
+                + from.cos_lat * to.cos_lat * cos(abs(from.coordinates.lng - to.coordinates.lng) * dr))
+        * EARTH_RADIUS;
+}
+
+double ComputeRouteLength(const PreparedCoordinates* points, size_t point_count, const size_t* begin, const size_t* end) {
+    if (begin == end) {
+        return 0;
+    }
+    if (*begin >= point_count) {
+        throw std::out_of_range("ComputeRouteLength: point id out of range");
+    }
+    double length = 0;
+    const PreparedCoordinates* from = points + *begin;
+    for (const size_t* it = begin + 1; it != end; ++it) {
+        if (*it >= point_count) {
+            throw std::out_of_range("ComputeRouteLength: point id out of range");
+        }
+        const PreparedCoordinates* to = points + *it;
+        length += ComputeDistance(*from, *to);
+        from = to;
+    }
+    return length;
+}
+
+namespace autotest {
+
+namespace {
+
+// Формула до появления PreparedCoordinates: все тригонометрические функции на каждый вызов
+double ComputeDistanceScalar(Coordinates from, Coordinates to) {
     using namespace std;
     if (from == to) {
         return 0;
     }
-    static const double dr = M_PI / 180.;
     return acos(sin(from.lat * dr) * sin(to.lat * dr)
                 + cos(from.lat * dr) * cos(to.lat * dr) * cos(abs(from.lng - to.lng) * dr))
-        * 6371000;
+        * EARTH_RADIUS;
+}
+
+bool SameDistance(double lhs, double rhs) {
+    return lhs == rhs || (std::isnan(lhs) && std::isnan(rhs));
+}
+
+// Точки вокруг Москвы, как в тестовых базах, и несколько крайних: полюса, линия перемены дат, экватор
+std::vector<Coordinates> MakePoints(size_t count) {
+    std::vector<Coordinates> points{
+        { 0, 0 }, { 90, 0 }, { -90, 180 }, { 0, 180 }, { 0, -180 }, { 55.7, 37.6 }, { 55.7, 37.6 },
+        { 55.7, 37.6000001 }, { -33.9, 151.2 }, { 64.1, -21.9 }, { 10, 179.9999 }, { 10, -179.9999 } };
+    unsigned state = 12345;
+    auto next = [&state]() {
+        state = state * 1103515245u + 12345u;
+        return static_cast<double>(state >> 8) / (1u << 24);
+    };
+    while (points.size() < count) {
+        points.push_back({ 55.5 + next() * 0.3, 37.4 + next() * 0.3 });
+    }
+    return points;
+}
+
+} // namespace
+
+void TestPreparedDistance() {
+    const std::vector<Coordinates> points = MakePoints(200);
+    for (const Coordinates& from : points) {
+        const PreparedCoordinates prepared_from = Prepare(from);
+        assert(ComputeDistance(prepared_from, prepared_from) == 0);
+        for (const Coordinates& to : points) {
+            const double expected = ComputeDistanceScalar(from, to);
+            assert(SameDistance(ComputeDistance(prepared_from, Prepare(to)), expected));
+            assert(SameDistance(ComputeDistance(from, to), expected));
+        }
+    }
+}
+
+void TestRouteLength() {
+    const std::vector<Coordinates> points = MakePoints(50);
+    std::vector<PreparedCoordinates> prepared;
+    for (const Coordinates& point : points) {
+        prepared.push_back(Prepare(point));
+    }
+    // С повторами подряд, как у кольцевого маршрута, проходящего через остановку дважды
+    const std::vector<size_t> ids{ 5, 6, 7, 20, 20, 31, 5, 12, 49, 5 };
+    double expected = 0;
+    for (size_t i = 0; i + 1 < ids.size(); ++i) {
+        expected += ComputeDistanceScalar(points[ids[i]], points[ids[i + 1]]);
+    }
+    assert(ComputeRouteLength(prepared.data(), prepared.size(), ids.data(), ids.data() + ids.size()) == expected);
+    assert(ComputeRouteLength(prepared.data(), prepared.size(), ids.data(), ids.data()) == 0);
+    assert(ComputeRouteLength(prepared.data(), prepared.size(), ids.data(), ids.data() + 1) == 0);
+
+    const size_t bad_id = prepared.size();
+    try {
+        ComputeRouteLength(prepared.data(), prepared.size(), &bad_id, &bad_id + 1);
+        assert(false);
+    }
+    catch (const std::out_of_range&) {
+        // ok
+    }
 }
 
+// Длина маршрутов по скалярной формуле, по подготовленным точкам попарно и через ComputeRouteLength
+void Benchmark() {
+    using namespace std::literals;
+    constexpr size_t POINT_COUNT = 10'000;
+    constexpr size_t ROUTE_SIZE = 2'000'000;
+    const std::vector<Coordinates> points = MakePoints(POINT_COUNT);
+    std::vector<PreparedCoordinates> prepared;
+    prepared.reserve(points.size());
+    for (const Coordinates& point : points) {
+        prepared.push_back(Prepare(point));
+    }
+    std::vector<size_t> ids(ROUTE_SIZE);
+    for (size_t i = 0; i < ids.size(); ++i) {
+        ids[i] = (i * 7919) % POINT_COUNT;
+    }
+
+    auto report = [](std::string_view name, auto compute) {
+        const auto start = std::chrono::steady_clock::now();
+        const double length = compute();
+        const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+        std::cout << name << ": "sv << duration.count() * 1000 << "ms, length "sv << length << std::endl;
+        return length;
+    };
+
+    const double scalar = report("scalar"sv, [&]() {
+        double length = 0;
+        for (size_t i = 0; i + 1 < ids.size(); ++i) {
+            length += ComputeDistanceScalar(points[ids[i]], points[ids[i + 1]]);
+        }
+        return length;
+    });
+    const double pairwise = report("prepared"sv, [&]() {
+        double length = 0;
+        for (size_t i = 0; i + 1 < ids.size(); ++i) {
+            length += ComputeDistance(prepared[ids[i]], prepared[ids[i + 1]]);
+        }
+        return length;
+    });
+    const double batch = report("route length"sv, [&]() {
+        return ComputeRouteLength(prepared.data(), prepared.size(), ids.data(), ids.data() + ids.size());
+    });
+    assert(scalar == pairwise && pairwise == batch);
+}
+
+int TestAll() {
+    TestPreparedDistance();
+    TestRouteLength();
+    Benchmark();
+    return 0;
+}
+
+} // namespace geo::autotest
+
 }  // namespace geo
\ No newline at end of file
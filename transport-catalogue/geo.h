@@ -1,7 +1,12 @@
 #pragma once
 
+#include <cstddef>
+
 namespace geo {
 
+// Радиус Земли в метрах, тот же, что в ComputeDistance
+inline constexpr double EARTH_RADIUS = 6371000;
+
 struct Coordinates {
     double lat; // Широта
     double lng; // Долгота
@@ -13,6 +18,33 @@ struct Coordinates {
     }
 };
 
+// Координаты с заранее посчитанными синусом и косинусом широты. Расстояние между такими точками
+// стоит одного cos и одного acos вместо пяти тригонометрических вызовов и бит в бит совпадает
+// с ComputeDistance для исходных координат
+struct PreparedCoordinates {
+    Coordinates coordinates{ 0, 0 };
+    double sin_lat = 0;
+    double cos_lat = 1;
+};
+
+PreparedCoordinates Prepare(Coordinates point);
+
 double ComputeDistance(Coordinates from, Coordinates to);
+double ComputeDistance(const PreparedCoordinates& from, const PreparedCoordinates& to);
+
+// Длина ломаной через точки points[id] для id из [begin, end): сумма ComputeDistance соседних точек
+// в том же порядке сложения, что и при попарных вызовах. point_count — размер points, id за его пределами
+// дают out_of_range
+double ComputeRouteLength(const PreparedCoordinates* points, size_t point_count, const size_t* begin, const size_t* end);
+
+namespace autotest {
+
+// Подготовленные точки и ComputeRouteLength сравниваются бит в бит с формулой по исходным координатам
+void TestPreparedDistance();
+void TestRouteLength();
+void Benchmark();
+int TestAll();
+
+} // namespace geo::autotest
 
 }  // namespace geo
\ No newline at end of file
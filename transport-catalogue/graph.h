@@ -3,6 +3,7 @@
 #include "ranges.h"
 
 #include <cstdlib>
+#include <stdexcept>
 #include <vector>
 #include <utility>
 
@@ -42,6 +43,38 @@ namespace graph {
         std::vector<IncidenceList> incidence_lists_;
     };
 
+    // Неизменяемый граф в формате CSR: рёбра хранятся в порядке id, а списки инцидентности
+    // всех вершин лежат подряд в одном массиве, incidence_[offsets_[v]..offsets_[v + 1]) — рёбра из v.
+    // Строится один раз из готового массива рёбер или собирается из массивов, сохранённых в базе
+    template <typename Weight>
+    class FrozenDirectedWeightedGraph {
+    public:
+        using IncidentEdgesRange = ranges::Range<const EdgeId*>;
+
+        FrozenDirectedWeightedGraph() = default;
+        FrozenDirectedWeightedGraph(size_t vertex_count, std::vector<Edge<Weight>> edges);
+        // Массивы могут ссылаться на отображённую в память базу, поэтому проверяются только их размеры.
+        // Id рёбер и вершин из них проверяют маршрутизаторы, когда их читают
+        FrozenDirectedWeightedGraph(ranges::Storage<Edge<Weight>> edges, ranges::Storage<size_t> offsets,
+            ranges::Storage<EdgeId> incidence);
+
+        size_t GetVertexCount() const;
+        size_t GetEdgeCount() const;
+        const Edge<Weight>& GetEdge(EdgeId edge_id) const;
+        IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
+
+        const ranges::Storage<Edge<Weight>>& GetEdges() const;
+        const ranges::Storage<size_t>& GetOffsets() const;
+        const ranges::Storage<EdgeId>& GetIncidence() const;
+
+    private:
+        ranges::Storage<Edge<Weight>> edges_;
+        ranges::Storage<size_t> offsets_ = std::vector<size_t>{ 0 };
+        ranges::Storage<EdgeId> incidence_;
+
+        void BuildIncidence(size_t vertex_count);
+    };
+
     template <typename Weight>
     DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count)
         : incidence_lists_(vertex_count) {
@@ -93,4 +126,89 @@ namespace graph {
         incidence_lists_.push_back({});
         return ret;
     }
+
+    template <typename Weight>
+    FrozenDirectedWeightedGraph<Weight>::FrozenDirectedWeightedGraph(size_t vertex_count, std::vector<Edge<Weight>> edges)
+        : edges_(std::move(edges)) {
+        BuildIncidence(vertex_count);
+    }
+
+    template <typename Weight>
+    FrozenDirectedWeightedGraph<Weight>::FrozenDirectedWeightedGraph(ranges::Storage<Edge<Weight>> edges,
+        ranges::Storage<size_t> offsets, ranges::Storage<EdgeId> incidence)
+        : edges_(std::move(edges))
+        , offsets_(std::move(offsets))
+        , incidence_(std::move(incidence)) {
+        if (offsets_.empty() || offsets_.front() != 0 || offsets_.back() != incidence_.size()
+            || incidence_.size() != edges_.size()) {
+            throw std::invalid_argument("FrozenDirectedWeightedGraph: inconsistent incidence arrays");
+        }
+    }
+
+    template <typename Weight>
+    void FrozenDirectedWeightedGraph<Weight>::BuildIncidence(size_t vertex_count) {
+        // Сортировка подсчётом по начальной вершине сохраняет порядок добавления рёбер,
+        // поэтому списки инцидентности совпадают с исходным графом
+        std::vector<size_t> offsets(vertex_count + 1, 0);
+        for (const auto& edge : edges_) {
+            if (edge.from >= vertex_count || edge.to >= vertex_count) {
+                throw std::out_of_range("FrozenDirectedWeightedGraph: edge vertex out of range");
+            }
+            ++offsets[edge.from + 1];
+        }
+        for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
+            offsets[vertex + 1] += offsets[vertex];
+        }
+        std::vector<EdgeId> incidence(edges_.size());
+        std::vector<size_t> positions(offsets.begin(), offsets.end() - 1);
+        for (EdgeId edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+            incidence[positions[edges_[edge_id].from]++] = edge_id;
+        }
+        offsets_ = std::move(offsets);
+        incidence_ = std::move(incidence);
+    }
+
+    template <typename Weight>
+    size_t FrozenDirectedWeightedGraph<Weight>::GetVertexCount() const {
+        return offsets_.size() - 1;
+    }
+
+    template <typename Weight>
+    size_t FrozenDirectedWeightedGraph<Weight>::GetEdgeCount() const {
+        return edges_.size();
+    }
+
+    template <typename Weight>
+    const Edge<Weight>& FrozenDirectedWeightedGraph<Weight>::GetEdge(EdgeId edge_id) const {
+        return edges_[edge_id];
+    }
+
+    template <typename Weight>
+    typename FrozenDirectedWeightedGraph<Weight>::IncidentEdgesRange
+        FrozenDirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
+        if (vertex >= GetVertexCount()) {
+            throw std::out_of_range("GetIncidentEdges: vertex out of range");
+        }
+        const size_t begin = offsets_[vertex];
+        const size_t end = offsets_[vertex + 1];
+        if (begin > end || end > incidence_.size()) {
+            throw std::invalid_argument("GetIncidentEdges: inconsistent incidence arrays");
+        }
+        return { incidence_.data() + begin, incidence_.data() + end };
+    }
+
+    template <typename Weight>
+    const ranges::Storage<Edge<Weight>>& FrozenDirectedWeightedGraph<Weight>::GetEdges() const {
+        return edges_;
+    }
+
+    template <typename Weight>
+    const ranges::Storage<size_t>& FrozenDirectedWeightedGraph<Weight>::GetOffsets() const {
+        return offsets_;
+    }
+
+    template <typename Weight>
+    const ranges::Storage<EdgeId>& FrozenDirectedWeightedGraph<Weight>::GetIncidence() const {
+        return incidence_;
+    }
 }// namespace graph
\ No newline at end of file
@@ -1,5 +1,10 @@
 #include "json.h"
 
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <limits>
+
 using namespace std;
 
 namespace json {
@@ -108,204 +113,383 @@ Array& Node::AsArray() {
     return std::get<Array>(*this);
 }
 
-namespace {
+Parser::Parser(std::istream& input, size_t buffer_size)
+    : input_(&input)
+    , buffer_(buffer_size)
+    , data_(buffer_.data()) {
+}
 
-Node LoadNode(istream& input);
+Parser::Parser(std::string_view text)
+    : data_(text.data())
+    , end_(text.size()) {
+}
 
-Node LoadArray(istream& input) {
-    Array result;
-    
-    bool first = true;
-    char c;
-    for (; input >> c && c != ']';) {
-        
-        if(first) {
-            if (c == ',') {
-                throw ParsingError("Array separator invalid: "s + c);
-            }
-            first = false;
-            input.putback(c);
-        } else if (c != ',') {
-            throw ParsingError("Array separator invalid: "s + c);
-        }
-        result.push_back(LoadNode(input));
+bool Parser::Fill() {
+    if (pos_ < end_) {
+        return true;
     }
-    
-    if(c != ']') {
-        throw ParsingError("Array ] not found"s);
+    if (!input_) {
+        return false;
     }
+    input_->read(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    data_ = buffer_.data();
+    pos_ = 0;
+    end_ = static_cast<size_t>(input_->gcount());
+    return end_ != 0;
+}
 
-    return Node(move(result));
+// Дочитывает вход за непрочитанным хвостом буфера, перенося хвост в начало, чтобы он и новые
+// данные лежали подряд. Возвращает false, если читать больше нечего
+bool Parser::Extend() {
+    if (!input_) {
+        return false;
+    }
+    const size_t tail = end_ - pos_;
+    std::memmove(buffer_.data(), data_ + pos_, tail);
+    if (tail == buffer_.size()) {
+        buffer_.resize(buffer_.size() * 2);
+    }
+    input_->read(buffer_.data() + tail, static_cast<std::streamsize>(buffer_.size() - tail));
+    data_ = buffer_.data();
+    pos_ = 0;
+    end_ = tail + static_cast<size_t>(input_->gcount());
+    return end_ != tail;
 }
 
-Node LoadDigit(istream& input) {
-    
-    std::string digit;
-    char temp;
-    temp = input.peek();
-    if(temp != '-' && !isdigit(temp)) {
-        throw ParsingError("Digit begin invalid: "s + temp);
+int Parser::PeekChar() {
+    if (!Fill()) {
+        return EOF;
     }
-    digit.push_back(input.get());
-    if(temp == '-') {
-        temp = input.peek();
-        if(!isdigit(temp)) {
-            throw ParsingError("First char is not digit: "s + temp);
-        }
-        digit.push_back(input.get());
+    return static_cast<unsigned char>(data_[pos_]);
+}
+
+char Parser::GetChar() {
+    if (!Fill()) {
+        throw ParsingError("Unexpected end of JSON"s);
     }
-    
-    while(isdigit(input.peek())) {
-        input >> temp;
-        digit.push_back(temp);
+    return data_[pos_++];
+}
+
+void Parser::SkipSpaces() {
+    for (int c = PeekChar(); c != EOF && (iscntrl(c) || isspace(c)); c = PeekChar()) {
+        ++pos_;
     }
-    temp = input.peek();
-    if(temp != '.' && temp != 'e' && temp != 'E') {
-        return Node(stoi(digit));
+}
+
+Parser::Event Parser::Next() {
+    if (lookahead_) {
+        Event event = *lookahead_;
+        lookahead_.reset();
+        return event;
     }
-    if(temp == '.') {
-        digit.push_back(input.get());
+    return ParseEvent();
+}
 
-        temp = input.peek();
-        if(!isdigit(temp)) {
-            throw ParsingError("Not digit after dot: "s + temp);
-        }
-        digit.push_back(input.get());
+Parser::Event Parser::Peek() {
+    if (!lookahead_) {
+        lookahead_ = ParseEvent();
+    }
+    return *lookahead_;
+}
 
-        while(isdigit(input.peek())) {
-            input >> temp;
-            digit.push_back(temp);
-        }
+const std::string& Parser::GetKey() const {
+    return key_;
+}
+
+const Node& Parser::GetValue() const {
+    if (string_pending_) {
+        value_ = Node(string_);
+        string_pending_ = false;
     }
-    
-    temp = input.peek();
-    if(temp != 'e' && temp != 'E') {
-        return Node(stod(digit));
+    return value_;
+}
+
+bool Parser::IsString() const {
+    return string_pending_ || value_.IsString();
+}
+
+std::string_view Parser::GetString() const {
+    if (string_pending_) {
+        return string_;
     }
-    
-    digit.push_back(input.get());
-    temp = input.peek();
-    if(temp != '+' && temp != '-' && !isdigit(temp)) {
-        throw ParsingError("Not +/- after e: "s + temp);
-    }
-    digit.push_back(input.get());
-    if(!isdigit(temp)) {
-        temp = input.peek();
-        if(!isdigit(temp)) {
-            throw ParsingError("Not digit after e+/-: "s + temp);
-        }
-        digit.push_back(input.get());
-    }
-    while(isdigit(input.peek())) {
-        input >> temp;
-        digit.push_back(temp);
-    }
-    return Node(stod(digit));
-}
-
-Node LoadString(istream& input) {    
-    string line;
-    char c;
-    for(c = input.get(); input && c != '\"'; c = input.get()) { 
-        if(c == '\\') {
-            c = input.get();
-            switch(c) {
-                case 'n': line.push_back('\n'); break;
-                case 'r': line.push_back('\r'); break;
-                case 't': line.push_back('\t'); break;
-                default: line.push_back(c);
-            }
-        } else {
-            line.push_back(c);
+    return value_.AsString();
+}
+
+Node Parser::ReadNode() {
+    switch (Next()) {
+    case Event::START_DICT: {
+        Dict result;
+        while (Next() == Event::KEY) {
+            string key = move(key_);
+            Node value = ReadNode();
+            result.insert({ move(key), move(value) });
         }
+        return Node(move(result));
     }
-    if(c != '\"') {
-        throw ParsingError("String is not closed"s);
+    case Event::START_ARRAY: {
+        Array result;
+        while (Peek() != Event::END_ARRAY) {
+            result.push_back(ReadNode());
+        }
+        Next();
+        return Node(move(result));
+    }
+    case Event::VALUE:
+        if (string_pending_) {
+            string_pending_ = false;
+            return Node(move(string_));
+        }
+        return move(value_);
+    default:
+        throw ParsingError("Value expected"s);
     }
-    return Node(move(line));
 }
 
-Node LoadDict(istream& input) {
-    Dict result;
-    bool first = true;
-    char c;
-    for (; input >> c && c != '}';) {
-        if(first) {
-            if (c == ',') {
-                throw ParsingError("Dict error format for first key \" != "s + c);
-            }
-            first = false;
-        } else if (c != ',') {
-            throw ParsingError("Dict error format , != "s + c);
-        } else {
-            input >> c;
+void Parser::SkipValue() {
+    size_t depth = 0;
+    do {
+        switch (Next()) {
+        case Event::START_DICT:
+        case Event::START_ARRAY:
+            ++depth;
+            break;
+        case Event::END_DICT:
+        case Event::END_ARRAY:
+            --depth;
+            break;
+        case Event::KEY:
+        case Event::VALUE:
+            break;
+        case Event::END_OF_DOCUMENT:
+            throw ParsingError("Value expected"s);
         }
-        
-        if(c != '\"') {
-            throw ParsingError("Dict error format \" != "s + c);
+    } while (depth != 0);
+}
+
+Parser::Event Parser::ParseEvent() {
+    SkipSpaces();
+
+    if (stack_.empty()) {
+        if (root_started_) {
+            return Event::END_OF_DOCUMENT;
         }
+        root_started_ = true;
+        return ParseValue();
+    }
 
-        string key = LoadString(input).AsString();
-        if(!(input >> c)) {
-            throw ParsingError("Dict } not found"s);
+    Frame& frame = stack_.back();
+    if (frame.is_dict) {
+        if (frame.after_key) {
+            frame.after_key = false;
+            return ParseValue();
+        }
+        char c = GetChar();
+        if (c == '}') {
+            stack_.pop_back();
+            return Event::END_DICT;
+        }
+        if (!frame.first) {
+            if (c != ',') {
+                throw ParsingError("Dict error format , != "s + c);
+            }
+            SkipSpaces();
+            c = GetChar();
+        }
+        frame.first = false;
+        if (c != '\"') {
+            throw ParsingError("Dict error format \" != "s + c);
         }
-        if(c != ':') {
+        key_.clear();
+        ParseString(key_);
+        SkipSpaces();
+        c = GetChar();
+        if (c != ':') {
             throw ParsingError("Dict error format : != "s + c);
         }
-        result.insert({move(key), LoadNode(input)});
+        frame.after_key = true;
+        return Event::KEY;
     }
-    if(c != '}') {
-        throw ParsingError("Dict } not found"s);
+
+    if (PeekChar() == ']') {
+        ++pos_;
+        stack_.pop_back();
+        return Event::END_ARRAY;
     }
-    return Node(move(result));
+    if (!frame.first) {
+        const char c = GetChar();
+        if (c != ',') {
+            throw ParsingError("Array separator invalid: "s + c);
+        }
+        SkipSpaces();
+    }
+    frame.first = false;
+    return ParseValue();
 }
-    
-Node LoadNull(istream& input) {
-    
-    if(input.get() == 'u' && input.get() == 'l' && input.get() == 'l') {
-        return Node(nullptr);
+
+Parser::Event Parser::ParseValue() {
+    string_pending_ = false;
+    const int c = PeekChar();
+    switch (c) {
+    case EOF:
+        throw ParsingError("Unexpected end of JSON"s);
+    case '{':
+        ++pos_;
+        stack_.push_back({ true });
+        return Event::START_DICT;
+    case '[':
+        ++pos_;
+        stack_.push_back({ false });
+        return Event::START_ARRAY;
+    case '"':
+        ++pos_;
+        string_.clear();
+        ParseString(string_);
+        string_pending_ = true;
+        return Event::VALUE;
+    case 'n':
+        ++pos_;
+        ParseLiteral("ull");
+        value_ = Node(nullptr);
+        return Event::VALUE;
+    case 't':
+        ++pos_;
+        ParseLiteral("rue");
+        value_ = Node(true);
+        return Event::VALUE;
+    case 'f':
+        ++pos_;
+        ParseLiteral("alse");
+        value_ = Node(false);
+        return Event::VALUE;
+    default:
+        value_ = ParseNumber();
+        return Event::VALUE;
     }
-    
-    throw ParsingError("null invalid"s);
 }
-    
-Node LoadBool(istream& input) {
-    std::string line;
-    int c = input.get();
-    if(c == 't' && input.get() == 'r' && input.get() == 'u' && input.get() == 'e') {
-        return Node(true);
-    } else if(c == 'f' && input.get() == 'a' && input.get() == 'l' && input.get() == 's' && input.get() == 'e') {
-        return Node(false);
+
+void Parser::ParseLiteral(const char* rest) {
+    for (; *rest; ++rest) {
+        if (PeekChar() != *rest) {
+            throw ParsingError("Invalid literal"s);
+        }
+        ++pos_;
     }
-    throw ParsingError("Invalid bool");
 }
 
-Node LoadNode(istream& input) {
-    char c;
-    
-    while(input >> c && (iscntrl(c) || isspace(c)));
-
-    if (c == '[') {
-        return LoadArray(input);
-    } else if (c == '{') {
-        return LoadDict(input);
-    } else if (c == '"') {
-        return LoadString(input);
-    } else if (c == 'n') {
-        return LoadNull(input);
-    } else if (c == 't' || c == 'f') {
-        input.putback(c);
-        return LoadBool(input);
-    } else {
-        input.putback(c);
-        return LoadDigit(input);
+void Parser::ParseString(std::string& line) {
+    for (;;) {
+        if (!Fill()) {
+            throw ParsingError("String is not closed"s);
+        }
+        // Участки без кавычек и обратных слэшей копируются целиком, поиск — через memchr
+        const char* begin = data_ + pos_;
+        const char* end = data_ + end_;
+        const char* quote = static_cast<const char*>(std::memchr(begin, '"', end - begin));
+        const char* limit = quote ? quote : end;
+        const char* backslash = static_cast<const char*>(std::memchr(begin, '\\', limit - begin));
+        const char* stop = backslash ? backslash : limit;
+        line.append(begin, stop);
+        pos_ = stop - data_;
+        if (stop == end) {
+            continue;
+        }
+        ++pos_;
+        if (stop == quote) {
+            return;
+        }
+
+        const char c = GetChar();
+        switch (c) {
+            case 'n': line.push_back('\n'); break;
+            case 'r': line.push_back('\r'); break;
+            case 't': line.push_back('\t'); break;
+            default: line.push_back(c);
+        }
     }
 }
-    
 
+namespace {
+
+bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+size_t GetNumberLength(const char* begin, const char* end) {
+    const char* it = begin;
+    while (it != end && (IsDigit(*it) || *it == '-' || *it == '+' || *it == '.' || *it == 'e' || *it == 'E')) {
+        ++it;
+    }
+    return it - begin;
+}
 
 }  // namespace
 
+Node Parser::ParseNumber() {
+    size_t length = GetNumberLength(data_ + pos_, data_ + end_);
+    while (pos_ + length == end_ && Extend()) {
+        length = GetNumberLength(data_ + pos_, data_ + end_);
+    }
+
+    const char* const begin = data_ + pos_;
+    const char* const last = begin + length;
+    const char* it = begin;
+    auto describe = [this, &it]() {
+        return it == data_ + end_ ? ""s : string(1, *it);
+    };
+    auto skip_digits = [&it, last]() {
+        while (it != last && IsDigit(*it)) {
+            ++it;
+        }
+    };
+
+    if (it != last && *it == '-') {
+        ++it;
+        if (it == last || !IsDigit(*it)) {
+            throw ParsingError("First char is not digit: "s + describe());
+        }
+    }
+    else if (it == last || !IsDigit(*it)) {
+        throw ParsingError("Digit begin invalid: "s + describe());
+    }
+    skip_digits();
+
+    bool is_int = true;
+    if (it != last && *it == '.') {
+        is_int = false;
+        ++it;
+        if (it == last || !IsDigit(*it)) {
+            throw ParsingError("Not digit after dot: "s + describe());
+        }
+        skip_digits();
+    }
+
+    if (it != last && (*it == 'e' || *it == 'E')) {
+        is_int = false;
+        ++it;
+        if (it != last && (*it == '+' || *it == '-')) {
+            ++it;
+        }
+        if (it == last || !IsDigit(*it)) {
+            throw ParsingError("Not digit after e+/-: "s + describe());
+        }
+        skip_digits();
+    }
+
+    pos_ = it - data_;
+    if (is_int) {
+        int value = 0;
+        if (std::from_chars(begin, it, value).ec != std::errc{}) {
+            throw ParsingError("Integer out of range: "s + string(begin, it));
+        }
+        return Node(value);
+    }
+    double value = 0;
+    if (std::from_chars(begin, it, value).ec != std::errc{}) {
+        throw ParsingError("Number out of range: "s + string(begin, it));
+    }
+    return Node(value);
+}
+
 Document::Document(Node root)
     : root_(move(root)) {
 }
@@ -323,9 +507,345 @@ const Node& Document::GetRoot() const {
 }
 
 Document Load(istream& input) {
-    return Document{LoadNode(input)};
+    return Document{Parser(input).ReadNode()};
+}
+
+Arena::Arena(size_t block_size)
+    : block_size_(block_size) {
+}
+
+void* Arena::Allocate(size_t size, size_t alignment) {
+    size_t padding = (alignment - reinterpret_cast<uintptr_t>(current_) % alignment) % alignment;
+    if (padding + size > left_) {
+        // Крупный кусок получает собственный блок, чтобы не бросать недоиспользованным текущий
+        if (size + alignment > block_size_ / 4) {
+            blocks_.emplace_back(new char[size + alignment]);
+            char* block = blocks_.back().get();
+            return block + (alignment - reinterpret_cast<uintptr_t>(block) % alignment) % alignment;
+        }
+        blocks_.emplace_back(new char[block_size_]);
+        current_ = blocks_.back().get();
+        left_ = block_size_;
+        padding = (alignment - reinterpret_cast<uintptr_t>(current_) % alignment) % alignment;
+    }
+    char* result = current_ + padding;
+    current_ += padding + size;
+    left_ -= padding + size;
+    return result;
+}
+
+std::string_view Arena::CopyString(std::string_view str) {
+    return { CopyArray(str.data(), str.size()), str.size() };
+}
+
+ArenaArray::ArenaArray(const ArenaNode* begin, const ArenaNode* end)
+    : begin_(begin)
+    , end_(end) {
+}
+
+size_t ArenaArray::size() const {
+    return end_ - begin_;
+}
+
+const ArenaNode& ArenaArray::at(size_t index) const {
+    if (index >= size()) {
+        throw std::out_of_range("ArenaArray index out of range"s);
+    }
+    return begin_[index];
+}
+
+const ArenaNode& ArenaArray::operator[](size_t index) const {
+    return begin_[index];
+}
+
+const ArenaNode* ArenaArray::begin() const {
+    return begin_;
+}
+
+const ArenaNode* ArenaArray::end() const {
+    return end_;
+}
+
+ArenaDict::ArenaDict(const ArenaMember* begin, const ArenaMember* end)
+    : begin_(begin)
+    , end_(end) {
+}
+
+size_t ArenaDict::size() const {
+    return end_ - begin_;
+}
+
+const ArenaMember* ArenaDict::find(std::string_view key) const {
+    const ArenaMember* it = std::lower_bound(begin_, end_, key, [](const ArenaMember& member, std::string_view key) {
+        return member.key < key;
+    });
+    return it != end_ && it->key == key ? it : end_;
+}
+
+size_t ArenaDict::count(std::string_view key) const {
+    return find(key) != end_ ? 1 : 0;
+}
+
+const ArenaNode& ArenaDict::at(std::string_view key) const {
+    const ArenaMember* it = find(key);
+    if (it == end_) {
+        throw std::out_of_range("No key in dict: "s + string(key));
+    }
+    return it->value;
+}
+
+const ArenaMember* ArenaDict::begin() const {
+    return begin_;
+}
+
+const ArenaMember* ArenaDict::end() const {
+    return end_;
+}
+
+ArenaNode::ArenaNode()
+    : string_(nullptr) {
+}
+
+ArenaNode::ArenaNode(std::nullptr_t)
+    : ArenaNode() {
+}
+
+ArenaNode::ArenaNode(bool value)
+    : type_(Type::BOOL)
+    , bool_(value) {
+}
+
+ArenaNode::ArenaNode(int value)
+    : type_(Type::INT)
+    , int_(value) {
+}
+
+ArenaNode::ArenaNode(double value)
+    : type_(Type::DOUBLE)
+    , double_(value) {
+}
+
+ArenaNode::ArenaNode(std::string_view value)
+    : type_(Type::STRING)
+    , size_(static_cast<uint32_t>(value.size()))
+    , string_(value.data()) {
+}
+
+ArenaNode::ArenaNode(ArenaArray array)
+    : type_(Type::ARRAY)
+    , size_(static_cast<uint32_t>(array.size()))
+    , items_(array.begin()) {
+}
+
+ArenaNode::ArenaNode(ArenaDict dict)
+    : type_(Type::DICT)
+    , size_(static_cast<uint32_t>(dict.size()))
+    , members_(dict.begin()) {
+}
+
+bool ArenaNode::IsInt() const {
+    return type_ == Type::INT;
+}
+bool ArenaNode::IsDouble() const {
+    return IsInt() || IsPureDouble();
+}
+bool ArenaNode::IsPureDouble() const {
+    return type_ == Type::DOUBLE;
+}
+bool ArenaNode::IsBool() const {
+    return type_ == Type::BOOL;
+}
+bool ArenaNode::IsString() const {
+    return type_ == Type::STRING;
+}
+bool ArenaNode::IsNull() const {
+    return type_ == Type::NULL_VALUE;
+}
+bool ArenaNode::IsArray() const {
+    return type_ == Type::ARRAY;
+}
+bool ArenaNode::IsDict() const {
+    return type_ == Type::DICT;
+}
+
+int ArenaNode::AsInt() const {
+    if (IsInt()) {
+        return int_;
+    }
+    throw std::logic_error("Node is not int");
+}
+bool ArenaNode::AsBool() const {
+    if (IsBool()) {
+        return bool_;
+    }
+    throw std::logic_error("Node is not bool");
+}
+double ArenaNode::AsDouble() const {
+    if (IsPureDouble()) {
+        return double_;
+    }
+    if (IsInt()) {
+        return int_;
+    }
+    throw std::logic_error("Node is not double");
+}
+std::string_view ArenaNode::AsString() const {
+    if (IsString()) {
+        return { string_, size_ };
+    }
+    throw std::logic_error("Node is not string");
+}
+ArenaArray ArenaNode::AsArray() const {
+    if (IsArray()) {
+        return { items_, items_ + size_ };
+    }
+    throw std::logic_error("Node is not Array");
+}
+ArenaDict ArenaNode::AsDict() const {
+    if (IsDict()) {
+        return { members_, members_ + size_ };
+    }
+    throw std::logic_error("Node is not map");
+}
+
+bool ArenaNode::operator==(std::string_view str) const {
+    return AsString() == str;
+}
+
+ArenaDocument::ArenaDocument(std::unique_ptr<Arena> arena, ArenaNode root)
+    : arena_(move(arena))
+    , root_(root) {
+}
+
+const ArenaNode& ArenaDocument::GetRoot() const {
+    return root_;
+}
+
+namespace {
+
+// Собирает ArenaNode из событий Parser. Элементы ещё не закрытых массивов и словарей копятся
+// в общих стеках items_ и members_ и переносятся в арену одним куском при закрытии
+class ArenaBuilder {
+public:
+    ArenaBuilder(Parser& parser, Arena& arena)
+        : parser_(parser)
+        , arena_(arena) {
+    }
+
+    ArenaNode Read(Parser::Event event) {
+        switch (event) {
+        case Parser::Event::START_DICT:
+            return ReadDict();
+        case Parser::Event::START_ARRAY:
+            return ReadArray();
+        case Parser::Event::VALUE:
+            return ReadValue();
+        default:
+            throw ParsingError("Value expected"s);
+        }
+    }
+
+private:
+    Parser& parser_;
+    Arena& arena_;
+    std::vector<ArenaNode> items_;
+    std::vector<ArenaMember> members_;
+
+    static uint32_t CheckSize(size_t size) {
+        if (size > std::numeric_limits<uint32_t>::max()) {
+            throw ParsingError("Container is too large"s);
+        }
+        return static_cast<uint32_t>(size);
+    }
+
+    ArenaNode ReadDict() {
+        const size_t first = members_.size();
+        while (parser_.Next() == Parser::Event::KEY) {
+            const std::string_view key = arena_.CopyString(parser_.GetKey());
+            const ArenaNode value = Read(parser_.Next());
+            members_.push_back({ key, value });
+        }
+
+        // При повторе ключа, как и в Dict, остаётся первое значение
+        const auto begin = members_.begin() + first;
+        std::stable_sort(begin, members_.end(), [](const ArenaMember& lhs, const ArenaMember& rhs) {
+            return lhs.key < rhs.key;
+        });
+        const auto last = std::unique(begin, members_.end(), [](const ArenaMember& lhs, const ArenaMember& rhs) {
+            return lhs.key == rhs.key;
+        });
+        const size_t count = CheckSize(last - begin);
+        const ArenaMember* members = arena_.CopyArray(members_.data() + first, count);
+        members_.resize(first);
+        return ArenaNode(ArenaDict(members, members + count));
+    }
+
+    ArenaNode ReadArray() {
+        const size_t first = items_.size();
+        for (Parser::Event event = parser_.Next(); event != Parser::Event::END_ARRAY; event = parser_.Next()) {
+            const ArenaNode item = Read(event);
+            items_.push_back(item);
+        }
+
+        const size_t count = CheckSize(items_.size() - first);
+        const ArenaNode* items = arena_.CopyArray(items_.data() + first, count);
+        items_.resize(first);
+        return ArenaNode(ArenaArray(items, items + count));
+    }
+
+    ArenaNode ReadValue() {
+        if (parser_.IsString()) {
+            const std::string_view str = parser_.GetString();
+            CheckSize(str.size());
+            return ArenaNode(arena_.CopyString(str));
+        }
+        const Node& value = parser_.GetValue();
+        if (value.IsInt()) {
+            return ArenaNode(value.AsInt());
+        }
+        if (value.IsPureDouble()) {
+            return ArenaNode(value.AsDouble());
+        }
+        if (value.IsBool()) {
+            return ArenaNode(value.AsBool());
+        }
+        return ArenaNode(nullptr);
+    }
+};
+
+ArenaDocument LoadArena(Parser& parser) {
+    auto arena = std::make_unique<Arena>();
+    ArenaNode root = ArenaBuilder(parser, *arena).Read(parser.Next());
+    return ArenaDocument(move(arena), root);
+}
+
+}  // namespace
+
+ArenaDocument LoadArena(std::istream& input) {
+    Parser parser(input);
+    return LoadArena(parser);
+}
+
+ArenaDocument LoadArena(std::string_view text) {
+    Parser parser(text);
+    return LoadArena(parser);
 }
     
+void PrintString(std::string_view str, std::ostream& os) {
+    os << '\"';
+    for(char c: str) {
+        switch(c) {
+            case '\n': os << "\\n"; break;
+            case '\r': os << "\\r"; break;
+            case '\"': os << "\\\""; break;
+            //case '\t': os << "\t"; break;
+            case '\\': os << "\\\\"; break;
+            default: os << c; break;
+        }
+    }
+    os << '\"';
+}
+
 struct NodePrinter {
   std::ostream& os;
     
@@ -336,18 +856,7 @@ struct NodePrinter {
         os << value;
     }
     void operator()(const std::string& str) {
-        os << '\"';
-        for(char c: str) {
-            switch(c) {
-                case '\n': os << "\\n"; break;
-                case '\r': os << "\\r"; break;
-                case '\"': os << "\\\""; break;
-                //case '\t': os << "\t"; break;
-                case '\\': os << "\\\\"; break;
-                default: os << c; break;
-            }
-        }
-        os << '\"';
+        PrintString(str, os);
     }
     void operator()(bool b) {
         os << (b ? "true" : "false");
@@ -404,8 +913,7 @@ void Print(const Document& doc, std::ostream& output) {
 }
 
 Document LoadJSON(const std::string& s) {
-    std::istringstream strm(s);
-    return Load(strm);
+    return Document{Parser(std::string_view{s}).ReadNode()};
 }
 
 std::string Print(const Node& node) {
@@ -633,6 +1141,71 @@ namespace autotest {
     const auto duration = std::chrono::steady_clock::now() - start;
     std::cout << std::chrono::duration_cast<std::chrono::milliseconds>(duration).count() << "ms"sv
         << std::endl;
+
+    BenchmarkThroughput();
+}
+
+// Скорость разбора документа, похожего на base_requests: много словарей с числами и строками.
+// Меряется и потоковый разбор из istream, и разбор строки в памяти
+[[maybe_unused]] void BenchmarkThroughput(int stop_count) {
+    using namespace std::literals;
+    std::ostringstream text;
+    text << "{\"base_requests\": ["sv;
+    for (int i = 0; i < stop_count; ++i) {
+        if (i != 0) {
+            text << ", "sv;
+        }
+        text << "{\"type\": \"Stop\", \"name\": \"Stop number "sv << i
+            << "\", \"latitude\": 43."sv << 500000 + i % 100000
+            << ", \"longitude\": 39.7"sv << 10000 + i % 50000
+            << ", \"road_distances\": {\"Stop number "sv << (i + 1) % stop_count << "\": "sv << 100 + i % 5000
+            << ", \"Stop \\\"quoted\\\" "sv << (i + 2) % stop_count << "\": "sv << 2000 + i % 300 << "}}"sv;
+    }
+    text << "]}"sv;
+    const std::string document = text.str();
+    const double megabytes = static_cast<double>(document.size()) / (1 << 20);
+
+    auto report = [megabytes](std::string_view name, auto load) {
+        const auto start = std::chrono::steady_clock::now();
+        const Document doc = load();
+        const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+        assert(doc.GetRoot().AsDict().at("base_requests"s).IsArray());
+        std::cout << name << ": "sv << megabytes << " MB in "sv << duration.count() * 1000 << "ms, "sv
+            << megabytes / duration.count() << " MB/s"sv << std::endl;
+    };
+
+    report("istream"sv, [&document]() {
+        std::istringstream input(document);
+        return Load(input);
+    });
+    report("memory"sv, [&document]() {
+        return LoadJSON(document);
+    });
+}
+
+[[maybe_unused]] void TestArena() {
+    using namespace std::literals;
+    const ArenaDocument doc = LoadArena(
+        "{ \"b\": [1, 2.5, true, null, \"s\\n\"], \"a\": { }, \"b\": 0, \"c\": \"\" }"sv);
+    const ArenaDict dict = doc.GetRoot().AsDict();
+    assert(dict.size() == 3);
+    // Ключи хранятся отсортированными, при повторе остаётся первое значение
+    assert(dict.begin()->key == "a"sv);
+    assert(dict.at("a"sv).AsDict().size() == 0);
+    assert(dict.at("c"sv) == ""sv);
+    assert(dict.count("d"sv) == 0);
+
+    const ArenaArray arr = dict.at("b"sv).AsArray();
+    assert(arr.size() == 5);
+    assert(arr[0].IsInt() && arr[0].AsDouble() == 1.0);
+    assert(arr[1].IsPureDouble() && arr[1].AsDouble() == 2.5);
+    assert(arr[2].AsBool());
+    assert(arr[3].IsNull());
+    assert(arr[4] == "s\n"sv);
+
+    MustThrowLogicError([&arr] {
+        arr[0].AsString();
+    });
 }
 
 int TestAll() {
@@ -643,6 +1216,7 @@ int TestAll() {
     TestBool();
     TestArray();
     TestMap();
+    TestArena();
     TestErrorHandling();
     Benchmark();
     return 0;
@@ -2,12 +2,18 @@
 
 #include <iostream>
 #include <map>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <variant>
 #include <sstream>
 #include <cassert>
 #include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
 
 namespace json {
 
@@ -84,14 +90,223 @@ private:
     Node root_;
 };
 
+// Потоковый разбор JSON по событиям. Вход читается большими блоками, документ целиком
+// не строится: Next() отдаёт очередное событие, ReadNode() — следующее значение в виде Node.
+// Так можно обрабатывать большой массив по одному элементу, не держа его в памяти.
+// Числа и строки разбираются прямо в буфере: число, упёршееся в конец блока, дочитывается
+// так, чтобы лежать в буфере подряд
+class Parser {
+public:
+    enum class Event {
+        START_DICT,
+        END_DICT,
+        START_ARRAY,
+        END_ARRAY,
+        KEY,   // ключ словаря, см. GetKey
+        VALUE, // null, bool, число или строка, см. GetValue
+        END_OF_DOCUMENT
+    };
+
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 1 << 16;
+
+    explicit Parser(std::istream& input, size_t buffer_size = DEFAULT_BUFFER_SIZE);
+    // Разбирает документ, целиком лежащий в памяти, без копирования
+    explicit Parser(std::string_view text);
+
+    Event Next();
+    Event Peek();
+
+    const std::string& GetKey() const;
+    const Node& GetValue() const;
+    // Для строкового значения — сама строка, без создания Node
+    bool IsString() const;
+    std::string_view GetString() const;
+
+    // Читает следующее значение целиком, включая вложенные словари и массивы
+    Node ReadNode();
+    // Пропускает следующее значение, не строя его
+    void SkipValue();
+
+private:
+    struct Frame {
+        bool is_dict;
+        bool first = true;
+        bool after_key = false;
+    };
+
+    std::istream* input_ = nullptr;
+    std::vector<char> buffer_;
+    const char* data_ = nullptr;
+    size_t pos_ = 0;
+    size_t end_ = 0;
+
+    std::vector<Frame> stack_;
+    bool root_started_ = false;
+    std::optional<Event> lookahead_;
+    std::string key_;
+    std::string string_;
+    // Строковое значение хранится в string_, а в value_ переносится только по запросу GetValue
+    mutable Node value_;
+    mutable bool string_pending_ = false;
+
+    bool Fill();
+    bool Extend();
+    int PeekChar();
+    char GetChar();
+    void SkipSpaces();
+
+    Event ParseEvent();
+    Event ParseValue();
+    void ParseString(std::string& output);
+    Node ParseNumber();
+    void ParseLiteral(const char* rest);
+};
+
 Document Load(std::istream& input);
 
+// DOM, все узлы, ключи и строки которого лежат в одной арене документа и освобождаются разом.
+// Словари хранятся отсортированным по ключу массивом, строки отдаются как string_view.
+// Рассчитан на разбор больших входных файлов, где Dict из std::map даёт миллионы мелких аллокаций
+class Arena {
+public:
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 1 << 20;
+
+    explicit Arena(size_t block_size = DEFAULT_BLOCK_SIZE);
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* Allocate(size_t size, size_t alignment);
+    std::string_view CopyString(std::string_view str);
+
+    template <typename T>
+    T* CopyArray(const T* items, size_t count);
+
+private:
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char* current_ = nullptr;
+    size_t left_ = 0;
+    size_t block_size_;
+};
+
+struct ArenaMember;
+class ArenaNode;
+
+class ArenaArray {
+public:
+    ArenaArray(const ArenaNode* begin, const ArenaNode* end);
+
+    size_t size() const;
+    const ArenaNode& at(size_t index) const;
+    const ArenaNode& operator[](size_t index) const;
+    const ArenaNode* begin() const;
+    const ArenaNode* end() const;
+
+private:
+    const ArenaNode* begin_;
+    const ArenaNode* end_;
+};
+
+class ArenaDict {
+public:
+    ArenaDict(const ArenaMember* begin, const ArenaMember* end);
+
+    size_t size() const;
+    // Двоичный поиск по ключу; end(), если ключа нет
+    const ArenaMember* find(std::string_view key) const;
+    size_t count(std::string_view key) const;
+    const ArenaNode& at(std::string_view key) const;
+    const ArenaMember* begin() const;
+    const ArenaMember* end() const;
+
+private:
+    const ArenaMember* begin_;
+    const ArenaMember* end_;
+};
+
+class ArenaNode {
+public:
+    ArenaNode();
+    ArenaNode(std::nullptr_t);
+    ArenaNode(bool value);
+    ArenaNode(int value);
+    ArenaNode(double value);
+    ArenaNode(std::string_view value);
+    ArenaNode(ArenaArray array);
+    ArenaNode(ArenaDict dict);
+
+    bool IsInt() const;
+    bool IsDouble() const;// Возвращает true, если в узле хранится int либо double.
+    bool IsPureDouble() const;
+    bool IsBool() const;
+    bool IsString() const;
+    bool IsNull() const;
+    bool IsArray() const;
+    bool IsDict() const;
+
+    int AsInt() const;
+    bool AsBool() const;
+    double AsDouble() const;
+    std::string_view AsString() const;
+    ArenaArray AsArray() const;
+    ArenaDict AsDict() const;
+
+    bool operator==(std::string_view str) const;
+
+private:
+    enum class Type : unsigned char {
+        NULL_VALUE, BOOL, INT, DOUBLE, STRING, ARRAY, DICT
+    };
+
+    Type type_ = Type::NULL_VALUE;
+    uint32_t size_ = 0;
+    union {
+        bool bool_;
+        int int_;
+        double double_;
+        const char* string_;
+        const ArenaNode* items_;
+        const ArenaMember* members_;
+    };
+};
+
+struct ArenaMember {
+    std::string_view key;
+    ArenaNode value;
+};
+
+class ArenaDocument {
+public:
+    ArenaDocument(std::unique_ptr<Arena> arena, ArenaNode root);
+
+    const ArenaNode& GetRoot() const;
+private:
+    std::unique_ptr<Arena> arena_;
+    ArenaNode root_;
+};
+
+ArenaDocument LoadArena(std::istream& input);
+ArenaDocument LoadArena(std::string_view text);
+
+template <typename T>
+T* Arena::CopyArray(const T* items, size_t count) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    if (count == 0) {
+        return nullptr;
+    }
+    T* result = static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+    std::memcpy(result, items, sizeof(T) * count);
+    return result;
+}
+
 void Print(const Document& doc, std::ostream& output);
     
 Document LoadJSON(const std::string& s);
 
 std::string Print(const Node& node);
 
+// Печатает строку в кавычках, экранируя спецсимволы так же, как Node::Print
+void PrintString(std::string_view str, std::ostream& output);
+
 namespace autotest {
 
 void MustFailToLoad(const std::string& s);
@@ -123,8 +338,10 @@ void TestStrings();
 void TestBool();
 void TestArray();
 void TestMap();
+void TestArena();
 void TestErrorHandling();
 void Benchmark();
+void BenchmarkThroughput(int stop_count = 200'000);
 int TestAll();
 } // namespace json::autotest
 
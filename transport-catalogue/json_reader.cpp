@@ -2,22 +2,25 @@
 
 #include "request_handler.h"
 #include "map_renderer.h"
-#include "json_builder.h"
+#include "json_writer.h"
 
+#include <algorithm>
+#include <set>
+#include <sstream>
 
 namespace transport {
 namespace json {
 
 using namespace std;
 using ::json::Load;
-using ::json::Builder;
+using ::json::Writer;
 
-renderer::Color ParseColor(const ::json::Node& color_node) {
+renderer::Color ParseColor(const ArenaNode& color_node) {
 	if (color_node.IsString()) {
-		return renderer::Color{ color_node.AsString() };
+		return renderer::Color{ std::string(color_node.AsString()) };
 	}
 	if (color_node.IsArray()) {
-		auto& arr = color_node.AsArray();
+		const auto arr = color_node.AsArray();
 		if (arr.size() == 3) {
 			return renderer::Rgb{
 				static_cast<unsigned char>(arr.at(0).AsInt()),
@@ -36,11 +39,11 @@ renderer::Color ParseColor(const ::json::Node& color_node) {
 		}
 	}
 
-	throw std::runtime_error("JSON color node invalid format: "s + color_node.Print());
+	throw std::runtime_error("JSON color node invalid format"s);
 }
 
-transport::renderer::RenderSettings ParseRenderSettings(const ::json::Node& render_node) {
-	const Dict& render_dict = render_node.AsDict();
+transport::renderer::RenderSettings ParseRenderSettings(const ArenaNode& render_node) {
+	const auto render_dict = render_node.AsDict();
 	renderer::RenderSettings render_settings;
 	render_settings.width = render_dict.at("width").AsDouble();
 	render_settings.height = render_dict.at("height").AsDouble();
@@ -51,249 +54,634 @@ transport::renderer::RenderSettings ParseRenderSettings(const ::json::Node& rend
 
 	render_settings.bus_label_font_size = render_dict.at("bus_label_font_size").AsInt();
 	{
-		auto& bus_label_offset = render_dict.at("bus_label_offset").AsArray();
+		const auto bus_label_offset = render_dict.at("bus_label_offset").AsArray();
 		render_settings.bus_label_offset = renderer::Point{ bus_label_offset[0].AsDouble(),  bus_label_offset[1].AsDouble() };
 	}
 
 	render_settings.stop_label_font_size = render_dict.at("stop_label_font_size").AsInt();
 	{
-		auto& stop_label_offset = render_dict.at("stop_label_offset").AsArray();
+		const auto stop_label_offset = render_dict.at("stop_label_offset").AsArray();
 		render_settings.stop_label_offset = renderer::Point{ stop_label_offset[0].AsDouble(),  stop_label_offset[1].AsDouble() };
 	}
 
 	render_settings.underlayer_color = ParseColor(render_dict.at("underlayer_color"));
 	render_settings.underlayer_width = render_dict.at("underlayer_width").AsDouble();
 
-	auto& color_palette = render_dict.at("color_palette").AsArray();
+	const auto color_palette = render_dict.at("color_palette").AsArray();
 	for (auto& color : color_palette) {
 		render_settings.color_palette.push_back(ParseColor(color));
 	}
 	return render_settings;
 }
 
-transport::router::RouterSettings ParseRouterSettings(const ::json::Node& settings_node) {
-	const Dict& settings_dict = settings_node.AsDict();
+transport::router::RouterSettings ParseRouterSettings(const ArenaNode& settings_node) {
+	const auto settings_dict = settings_node.AsDict();
 	router::RouterSettings router_settings;
 
 	router_settings.bus_velocity = settings_dict.at("bus_velocity").AsDouble();
 	router_settings.bus_wait_time = settings_dict.at("bus_wait_time").AsDouble();
 
+	if (auto it = settings_dict.find("routing_engine"); it != settings_dict.end()) {
+		const string_view engine = it->value.AsString();
+		if (engine == "all_pairs"s) {
+			router_settings.engine = router::RouterEngine::ALL_PAIRS;
+		}
+		else if (engine == "dijkstra"s) {
+			router_settings.engine = router::RouterEngine::DIJKSTRA;
+		}
+		else if (engine == "contraction_hierarchy"s) {
+			router_settings.engine = router::RouterEngine::CONTRACTION_HIERARCHY;
+		}
+		else {
+			throw std::runtime_error("Unknown routing_engine: "s + string(engine));
+		}
+	}
+
 	return router_settings;
 }
 
-Base BaseReader::operator()(const Document& document) {
-	const Node& root = document.GetRoot();
-	const Dict& dict = root.AsDict();
+Base BaseReader::operator()(const ArenaDocument& document) {
+	const auto dict = document.GetRoot().AsDict();
 
 	render_settings_ = ParseRenderSettings(dict.at("render_settings"));
 	router_settings_ = ParseRouterSettings(dict.at("routing_settings"));
 	InputReader(dict.at("base_requests"));
+	transport_catalogue_.ComputeBusStats();
+	transport_catalogue_.BuildStopIndex();
 	router_.emplace(std::ref(transport_catalogue_), router_settings_);
-	return {std::move(transport_catalogue_), render_settings_ , std::move(*router_)};
+	std::string map = renderer::MapRender{ render_settings_, transport_catalogue_ }.Render();
+	return {std::move(transport_catalogue_), render_settings_ , std::move(*router_), std::move(map)};
 }
 
-void BaseReader::InputReader(const Node& input_node) {
-	const Array& buses_stops = input_node.AsArray();
-	vector<const Node*> buses;
-	vector<const Node*> stops;
+void BaseReader::InputReader(const ArenaNode& input_node) {
+	const auto buses_stops = input_node.AsArray();
+	vector<const ArenaNode*> buses;
+	vector<const ArenaNode*> stops;
 	buses.reserve(buses_stops.size());
 	stops.reserve(buses_stops.size());
 
-	for (const Node& node : buses_stops) {
-		const Dict& dict = node.AsDict();
+	for (const ArenaNode& node : buses_stops) {
+		const auto dict = node.AsDict();
 
-		if (dict.at("type") == "Stop"s) {
+		if (dict.at("type") == "Stop"sv) {
 			stops.push_back(&node);
-			transport_catalogue_.AddStop(dict.at("name").AsString(),
+			transport_catalogue_.AddStop(std::string(dict.at("name").AsString()),
 				geo::Coordinates{ dict.at("latitude").AsDouble(), dict.at("longitude").AsDouble() });
 		}
-		else if (dict.at("type") == "Bus"s) {
+		else if (dict.at("type") == "Bus"sv) {
 			buses.push_back(&node);
 		}
 	}
 
+	std::vector<std::string_view> stop_names;
 	for (auto& bus : buses) {
-		const Dict& dict = bus->AsDict();
-		std::vector<std::string> stop_names;
-		const Array& stops = dict.at("stops").AsArray();
+		const auto dict = bus->AsDict();
+		const auto stops = dict.at("stops").AsArray();
 		stop_names.resize(stops.size());
 
-		transform(stops.begin(), stops.end(), stop_names.begin(), [](auto& node) {
+		transform(stops.begin(), stops.end(), stop_names.begin(), [](const ArenaNode& node) {
 			return node.AsString();
 			});
 
-		transport_catalogue_.AddBus(dict.at("name").AsString(), dict.at("is_roundtrip").AsBool(), stop_names);
+		transport_catalogue_.AddBus(std::string(dict.at("name").AsString()), dict.at("is_roundtrip").AsBool(), stop_names);
 	}
 
-	std::unordered_map<std::string, std::unordered_map<std::string, size_t>> length_from_to;
+	auto get_stop_id = [this](string_view name) {
+		const Stop* stop = transport_catalogue_.GetStop(name);
+		if (!stop) {
+			throw std::out_of_range("Unknown stop: "s + string(name));
+		}
+		return stop->id_;
+	};
 	for (auto& stop : stops) {
-		const Dict& dict = stop->AsDict();
-		const Dict& other_stops = dict.at("road_distances").AsDict();
-		const string& name = dict.at("name").AsString();
-		for (auto& [other_name, node_len] : other_stops) {
-			length_from_to[name][other_name] = node_len.AsInt();
+		const auto dict = stop->AsDict();
+		const size_t from_id = get_stop_id(dict.at("name").AsString());
+		for (auto& [other_name, node_len] : dict.at("road_distances").AsDict()) {
+			transport_catalogue_.SetLengthBetweenStops(from_id, get_stop_id(other_name), node_len.AsInt());
+		}
+	}
+}
+
+namespace {
+
+bool IsRemoved(const ArenaNode& request) {
+	const auto dict = request.AsDict();
+	const auto it = dict.find("remove");
+	return it != dict.end() && it->value.AsBool();
+}
+
+} // namespace
+
+Base BaseUpdater::operator()(Base base, const ArenaDocument& document) {
+	const auto dict = document.GetRoot().AsDict();
+	const TransportCatalogue& previous = base.transport_catalogue;
+
+	ReadRequests(dict.at("base_requests"));
+	UpdateStops(previous);
+	UpdateRoadDistances(previous);
+	UpdateBuses(previous);
+	UpdateBusStats(previous);
+	transport_catalogue_.BuildStopIndex();
+
+	bool map_changed = stops_changed_ || buses_changed_;
+	if (const auto it = dict.find("render_settings"); it != dict.end()) {
+		base.render_settings = ParseRenderSettings(it->value);
+		map_changed = true;
+	}
+
+	const RouterSettings previous_router_settings = base.router.GetSettings();
+	RouterSettings router_settings = previous_router_settings;
+	if (const auto it = dict.find("routing_settings"); it != dict.end()) {
+		router_settings = ParseRouterSettings(it->value);
+	}
+	// Веса рёбер зависят от скорости и времени ожидания, при их смене рёбра строятся заново
+	std::vector<size_t> edge_sources(transport_catalogue_.GetBuses().size(), router::GraphBuilder::NO_BUS);
+	if (router_settings.bus_velocity == previous_router_settings.bus_velocity
+		&& router_settings.bus_wait_time == previous_router_settings.bus_wait_time) {
+		edge_sources = GetEdgeSources();
+	}
+	router::Graph graph = router::GraphBuilder(transport_catalogue_, router_settings)
+		.Build(base.router.GetGraph(), edge_sources, stop_ids_);
+	Router router{ std::move(graph), router_settings };
+
+	if (map_changed) {
+		base.map = renderer::MapRender{ base.render_settings, transport_catalogue_ }.Render();
+	}
+	return { std::move(transport_catalogue_), base.render_settings, std::move(router), std::move(base.map) };
+}
+
+void BaseUpdater::ReadRequests(const ArenaNode& input_node) {
+	for (const ArenaNode& node : input_node.AsArray()) {
+		const auto dict = node.AsDict();
+		const string_view name = dict.at("name").AsString();
+		if (dict.at("type") == "Stop"sv) {
+			const bool remove = IsRemoved(node);
+			auto [request_it, inserted] = stop_requests_.try_emplace(name);
+			StopRequest& request = request_it->second;
+			if (inserted) {
+				stop_order_.push_back(name);
+				request.remove = remove;
+			}
+			else if (request.remove != remove) {
+				throw std::invalid_argument("Stop is both removed and updated: "s + string(name));
+			}
+			if (remove) {
+				continue;
+			}
+			if (dict.count("latitude") > 0 || dict.count("longitude") > 0) {
+				request.coordinates = geo::Coordinates{ dict.at("latitude").AsDouble(), dict.at("longitude").AsDouble() };
+			}
+			if (const auto it = dict.find("road_distances"); it != dict.end()) {
+				for (auto& [other_name, node_len] : it->value.AsDict()) {
+					request.road_distances[other_name] = static_cast<size_t>(node_len.AsInt());
+				}
+			}
+		}
+		else if (dict.at("type") == "Bus"sv) {
+			if (bus_requests_.count(name) == 0) {
+				bus_order_.push_back(name);
+			}
+			bus_requests_[name] = &node;
+		}
+	}
+}
+
+// Остановки старой базы сохраняют взаимный порядок id, новые добавляются в конец
+void BaseUpdater::UpdateStops(const TransportCatalogue& previous) {
+	const auto& stops = previous.GetStops();
+	stop_ids_.assign(stops.size(), NO_ID);
+	for (const Stop& stop : stops) {
+		geo::Coordinates coordinates = stop.coordinates_;
+		if (const auto it = stop_requests_.find(stop.name_); it != stop_requests_.end()) {
+			if (it->second.remove) {
+				stops_changed_ = true;
+				continue;
+			}
+			coordinates = it->second.coordinates.value_or(coordinates);
+		}
+		stop_ids_[stop.id_] = transport_catalogue_.GetStops().size();
+		moved_stops_.push_back(coordinates != stop.coordinates_);
+		transport_catalogue_.AddStop(stop.name_, coordinates);
+	}
+
+	for (const string_view name : stop_order_) {
+		if (previous.GetStop(name)) {
+			continue;
+		}
+		const StopRequest& request = stop_requests_.at(name);
+		if (request.remove) {
+			throw std::out_of_range("Unknown stop: "s + string(name));
+		}
+		if (!request.coordinates) {
+			throw std::out_of_range("New stop without coordinates: "s + string(name));
+		}
+		moved_stops_.push_back(true);
+		transport_catalogue_.AddStop(string(name), *request.coordinates);
+	}
+	stops_changed_ = stops_changed_ || any_of(moved_stops_.begin(), moved_stops_.end(), [](bool moved) { return moved; });
+}
+
+// Расстояния старой базы хранятся по обоим направлениям, поэтому переносятся как есть.
+// Обратное к заданному направление меняется вместе с ним, если не задано явно и до изменения
+// совпадало с прямым, — так же, как его достраивает SetLengthBetweenStops в make_base
+void BaseUpdater::UpdateRoadDistances(const TransportCatalogue& previous) {
+	RoadDistances distances;
+	previous.GetRoadDistances().ForEach([this, &distances](size_t from, size_t to, size_t length) {
+		if (stop_ids_[from] != NO_ID && stop_ids_[to] != NO_ID) {
+			distances.Set(stop_ids_[from], stop_ids_[to], length);
+		}
+	});
+
+	struct Change {
+		size_t from;
+		size_t to;
+		size_t length;
+		size_t previous_length;
+		size_t previous_reverse_length;
+	};
+	std::vector<Change> changes;
+	std::set<std::pair<size_t, size_t>> explicit_pairs;
+	for (const string_view name : stop_order_) {
+		const StopRequest& request = stop_requests_.at(name);
+		if (request.remove || request.road_distances.empty()) {
+			continue;
+		}
+		const size_t from = GetStopId(name);
+		for (const auto& [other_name, length] : request.road_distances) {
+			const size_t to = GetStopId(other_name);
+			changes.push_back({ from, to, length, distances.Get(from, to), distances.Get(to, from) });
+			explicit_pairs.insert({ from, to });
+		}
+	}
+
+	touched_stops_.assign(transport_catalogue_.GetStops().size(), false);
+	auto set_length = [this, &distances](size_t from, size_t to, size_t length) {
+		if (distances.Get(from, to) != length) {
+			touched_stops_[from] = true;
+			touched_stops_[to] = true;
+		}
+		distances.Set(from, to, length);
+	};
+	for (const Change& change : changes) {
+		set_length(change.from, change.to, change.length);
+	}
+	for (const Change& change : changes) {
+		if (explicit_pairs.count({ change.to, change.from }) == 0 && change.previous_reverse_length == change.previous_length) {
+			set_length(change.to, change.from, change.length);
+		}
+	}
+
+	distances.ForEach([this](size_t from, size_t to, size_t length) {
+		transport_catalogue_.SetLengthBetweenStops(from, to, length);
+	});
+}
+
+void BaseUpdater::UpdateBuses(const TransportCatalogue& previous) {
+	std::vector<size_t> stop_ids;
+	auto add_requested_bus = [this, &stop_ids](string_view name, const ArenaNode& request) {
+		const auto dict = request.AsDict();
+		stop_ids.clear();
+		for (const ArenaNode& stop : dict.at("stops").AsArray()) {
+			stop_ids.push_back(GetStopId(stop.AsString()));
+		}
+		transport_catalogue_.AddBusWithStopIds(string(name), dict.at("is_roundtrip").AsBool(), stop_ids);
+		previous_bus_ids_.push_back(NO_ID);
+		buses_changed_ = true;
+	};
+
+	for (const Bus& bus : previous.GetBuses()) {
+		if (const auto it = bus_requests_.find(bus.name_); it != bus_requests_.end()) {
+			if (IsRemoved(*it->second)) {
+				buses_changed_ = true;
+			}
+			else {
+				add_requested_bus(bus.name_, *it->second);
+			}
+			continue;
+		}
+
+		stop_ids.clear();
+		for (size_t stop_id : previous.GetBusStopIds(&bus)) {
+			if (stop_ids_[stop_id] == NO_ID) {
+				throw std::logic_error("Stop "s + previous.GetStopById(stop_id)->name_ + " is used by bus "s + bus.name_);
+			}
+			stop_ids.push_back(stop_ids_[stop_id]);
+		}
+		transport_catalogue_.AddBusWithStopIds(bus.name_, bus.circular_, stop_ids);
+		previous_bus_ids_.push_back(bus.id_);
+	}
+
+	for (const string_view name : bus_order_) {
+		if (previous.GetBus(name)) {
+			continue;
+		}
+		const ArenaNode& request = *bus_requests_.at(name);
+		if (IsRemoved(request)) {
+			throw std::out_of_range("Unknown bus: "s + string(name));
+		}
+		add_requested_bus(name, request);
+	}
+}
+
+// Статистика автобуса переносится, если не изменились ни его остановки, ни их координаты, ни расстояния между ними
+void BaseUpdater::UpdateBusStats(const TransportCatalogue& previous) {
+	const auto& buses = transport_catalogue_.GetBuses();
+	std::vector<size_t> stat_sources(buses.size(), NO_ID);
+	for (size_t bus_id = 0; bus_id < buses.size(); ++bus_id) {
+		if (previous_bus_ids_[bus_id] == NO_ID) {
+			continue;
+		}
+		const auto stop_ids = transport_catalogue_.GetBusStopIds(&buses[bus_id]);
+		const bool changed = any_of(stop_ids.begin(), stop_ids.end(), [this](size_t stop_id) {
+			return moved_stops_[stop_id] || touched_stops_[stop_id];
+		});
+		if (!changed) {
+			stat_sources[bus_id] = previous_bus_ids_[bus_id];
 		}
 	}
 
-	transport_catalogue_.SetLengthBetweenStops(length_from_to);
+	std::vector<BusStat> bus_stats(buses.size());
+	parallel::ForEachIndex(buses.size(), [this, &previous, &buses, &stat_sources, &bus_stats](size_t bus_id) {
+		bus_stats[bus_id] = stat_sources[bus_id] == NO_ID
+			? transport_catalogue_.GetBusStat(&buses[bus_id])
+			: previous.GetBusStat(previous.GetBusById(stat_sources[bus_id]));
+	});
+	transport_catalogue_.SetBusStats(std::move(bus_stats));
 }
 
-StatReader::StatReader(const Base& base) : base_{ base } {}
+// Рёбра зависят только от остановок автобуса и расстояний между ними
+std::vector<size_t> BaseUpdater::GetEdgeSources() const {
+	const auto& buses = transport_catalogue_.GetBuses();
+	std::vector<size_t> edge_sources(buses.size(), router::GraphBuilder::NO_BUS);
+	for (size_t bus_id = 0; bus_id < buses.size(); ++bus_id) {
+		if (previous_bus_ids_[bus_id] == NO_ID) {
+			continue;
+		}
+		const auto stop_ids = transport_catalogue_.GetBusStopIds(&buses[bus_id]);
+		const bool touched = any_of(stop_ids.begin(), stop_ids.end(), [this](size_t stop_id) {
+			return touched_stops_[stop_id];
+		});
+		if (!touched) {
+			edge_sources[bus_id] = previous_bus_ids_[bus_id];
+		}
+	}
+	return edge_sources;
+}
 
-Document StatReader::operator()(const Document& document) {
-	const Node& root = document.GetRoot();
-	const Dict& dict = root.AsDict();
+size_t BaseUpdater::GetStopId(string_view name) const {
+	const Stop* stop = transport_catalogue_.GetStop(name);
+	if (!stop) {
+		throw std::out_of_range("Unknown stop: "s + string(name));
+	}
+	return stop->id_;
+}
+
+namespace {
 
-	return Document(StatRequests(dict.at("stat_requests")));
+RequestHandler MakeRequestHandler(const StatBase& base) {
+	if (const auto* query_base = std::get_if<std::unique_ptr<flat::QueryBase>>(&base)) {
+		return RequestHandler(**query_base);
+	}
+	const Base& loaded = std::get<Base>(base);
+	return RequestHandler(loaded.transport_catalogue, loaded.render_settings, loaded.map, loaded.router);
 }
 
-::json::Node StatReader::StatRequests(const Node& stat_node) {
-	renderer::MapRender map_renderer{ 
-		base_.render_settings, 
-		base_.transport_catalogue.GetBuses().begin(), 
-		base_.transport_catalogue.GetBuses().end() };
+} // namespace
+
+StatReader::StatReader(const StatBase& base, size_t thread_count)
+	: request_handler_(MakeRequestHandler(base))
+	, thread_count_{ std::max<size_t>(1, thread_count) } {
+}
+
+void StatReader::operator()(::json::Parser& parser, std::ostream& output) const {
+	if (parser.Next() != ::json::Parser::Event::START_ARRAY) {
+		throw ::json::ParsingError("stat_requests must be an array"s);
+	}
+
+	Writer writer{ output };
+	writer.StartArray();
+	vector<Node> batch;
+	batch.reserve(thread_count_ > 1 ? BATCH_SIZE : 1);
+	while (parser.Peek() != ::json::Parser::Event::END_ARRAY) {
+		batch.push_back(parser.ReadNode());
+		if (batch.size() == batch.capacity()) {
+			AnswerBatch(batch.data(), batch.data() + batch.size(), writer);
+			batch.clear();
+		}
+	}
+	parser.Next();
+	AnswerBatch(batch.data(), batch.data() + batch.size(), writer);
+	writer.EndArray();
+}
 
-	RequestHandler request_handler(base_.transport_catalogue, map_renderer, base_.router);
-	return StatRequests(stat_node, request_handler);
+void StatReader::operator()(const Node& stat_requests, std::ostream& output) const {
+	const Array& requests = stat_requests.AsArray();
+	Writer writer{ output };
+	writer.StartArray();
+	for (size_t first = 0; first < requests.size(); first += BATCH_SIZE) {
+		const size_t last = std::min(requests.size(), first + BATCH_SIZE);
+		AnswerBatch(requests.data() + first, requests.data() + last, writer);
+	}
+	writer.EndArray();
 }
 
-::json::Node StatReader::StatRequests(const Node& stat_node, const RequestHandler& request_handler) {
-	Array result{};
-	for (auto& request : stat_node.AsArray()) {
-		result.push_back(StatRequest(request.AsDict(), request_handler));
+void StatReader::AnswerBatch(const Node* begin, const Node* end, Writer& writer) const {
+	if (thread_count_ == 1) {
+		for (const Node* request = begin; request != end; ++request) {
+			StatRequest(request->AsDict(), writer);
+		}
+		return;
+	}
+
+	// Каждый поток пишет ответ в свою строку, в общий поток они уходят уже по порядку
+	vector<string> answers(end - begin);
+	parallel::ForEachIndex(answers.size(), [&](size_t i) {
+		ostringstream answer;
+		Writer answer_writer{ answer };
+		StatRequest(begin[i].AsDict(), answer_writer);
+		answers[i] = answer.str();
+	}, thread_count_);
+
+	for (const string& answer : answers) {
+		writer.RawValue(answer);
 	}
-	return ::json::Node{ move(result) };
 }
 
-::json::Node StatReader::StatRequest(const Dict& request, const RequestHandler& request_handler) {
+// Ключи ответов пишутся в алфавитном порядке, как их раньше печатал Dict
+void StatReader::StatRequest(const Dict& request, Writer& writer) const {
 	auto& type = request.at("type");
 	if (type == "Bus"s) {
-		return BusRequest(request, request_handler);
+		return BusRequest(request, writer);
 	}
 
 	if (type == "Stop"s) {
-		return StopRequest(request, request_handler);
+		return StopRequest(request, writer);
 	}
 
 	if (type == "Map"s) {
-		return MapRequest(request, request_handler);
+		return MapRequest(request, writer);
 	}
 
 	if (type == "Route"s) {
-		return RouteRequest(request, request_handler);
+		return RouteRequest(request, writer);
 	}
-	return ::json::Node{ Dict {} };
+
+	if (type == "NearestStops"s) {
+		return NearestStopsRequest(request, writer);
+	}
+	writer.StartDict().EndDict();
 }
 
-Node StatReader::BusRequest(const Dict& request, const RequestHandler& request_handler) {
-	auto builder = Builder{}
+void StatReader::NotFound(const Dict& request, Writer& writer) const {
+	writer
 		.StartDict()
-		.Key("request_id").Value(request.at("id").AsInt());
+		.Key("error_message").Value("not found")
+		.Key("request_id").Value(request.at("id").AsInt())
+		.EndDict();
+}
 
-	auto request_result = request_handler.GetBusStat(request.at("name").AsString());
+void StatReader::BusRequest(const Dict& request, Writer& writer) const {
+	auto request_result = request_handler_.GetBusStat(request.at("name").AsString());
 
 	if (!request_result) {
-		return builder.Key("error_message").Value("not found"s).EndDict().Build();
+		return NotFound(request, writer);
 	}
 
-	return builder
+	writer
+		.StartDict()
 		.Key("curvature").Value(request_result->curvature)
+		.Key("request_id").Value(request.at("id").AsInt())
 		.Key("route_length").Value(static_cast<int>(request_result->route_length))
 		.Key("stop_count").Value(static_cast<int>(request_result->stop_count))
 		.Key("unique_stop_count").Value(static_cast<int>(request_result->unique_stop_count))
-		.EndDict().Build();
+		.EndDict();
 }
 
 
-::json::Node StatReader::StopRequest(const Dict& request, const RequestHandler& request_handler) {
-	auto builder = Builder{}
-		.StartDict()
-		.Key("request_id").Value(request.at("id").AsInt());
-
-	auto request_result = request_handler.GetSortedBusesByStop(request.at("name").AsString());
+void StatReader::StopRequest(const Dict& request, Writer& writer) const {
+	auto request_result = request_handler_.GetSortedBusesByStop(request.at("name").AsString());
 
 	if (!request_result) {
-		return builder.Key("error_message").Value("not found"s).EndDict().Build();
+		return NotFound(request, writer);
 	}
 
-	auto array_builder = builder.Key("buses").StartArray();
-
+	writer.StartDict().Key("buses").StartArray();
 	for (auto& name : *request_result) {
-		array_builder.Value(std::string(name));
+		writer.Value(name);
 	}
-
-	return array_builder.EndArray().EndDict().Build();
+	writer
+		.EndArray()
+		.Key("request_id").Value(request.at("id").AsInt())
+		.EndDict();
 }
 
 
-::json::Node StatReader::MapRequest(const Dict& request, const RequestHandler& request_handler) {
-	return Builder{}
+// Без bbox и tile — вся карта. bbox: [min_x, min_y, max_x, max_y] в координатах карты,
+// tile: { "z": ..., "x": ..., "y": ... }. Пустой или перевёрнутый bbox, как и тайл за пределами карты, — not found
+void StatReader::MapRequest(const Dict& request, Writer& writer) const {
+	std::optional<std::string> map;
+	if (auto it = request.find("bbox"s); it != request.end()) {
+		const Array& bbox = it->second.AsArray();
+		if (bbox.size() != 4) {
+			throw std::logic_error("bbox must contain 4 numbers"s);
+		}
+		const renderer::Viewport viewport{
+			{ bbox[0].AsDouble(), bbox[1].AsDouble() }, { bbox[2].AsDouble(), bbox[3].AsDouble() } };
+		if (!(viewport.min.x < viewport.max.x && viewport.min.y < viewport.max.y)) {
+			return NotFound(request, writer);
+		}
+		map = request_handler_.RenderMap(viewport);
+	}
+	else if (auto it = request.find("tile"s); it != request.end()) {
+		const Dict& tile = it->second.AsDict();
+		map = request_handler_.RenderMapTile(tile.at("z"s).AsInt(), tile.at("x"s).AsInt(), tile.at("y"s).AsInt());
+		if (!map) {
+			return NotFound(request, writer);
+		}
+	}
+
+	writer
 		.StartDict()
+		.Key("map").Value(map ? std::string_view(*map) : request_handler_.RenderMap())
 		.Key("request_id").Value(request.at("id").AsInt())
-		.Key("map").Value(request_handler.RenderMap())
-		.EndDict()
-		.Build();
+		.EndDict();
 }
 
 
-::json::Node StatReader::RouteRequest(const Dict& request, const RequestHandler& request_handler) {
-	using namespace std::string_literals;
-	auto builder = Builder{}
-		.StartDict()
-		.Key("request_id").Value(request.at("id").AsInt());
-
-	auto route = request_handler.BuildRoute(request.at("from").AsString(), request.at("to").AsString());
+void StatReader::RouteRequest(const Dict& request, Writer& writer) const {
+	auto route = request_handler_.BuildRoute(request.at("from").AsString(), request.at("to").AsString());
 
 	if (!route) {
-		return builder
-			.Key("error_message")
-			.Value("not found")
-			.EndDict()
-			.Build();
+		return NotFound(request, writer);
 	}
 
 	const Router::RouteInfo& route_val = route.value();
-	auto items = builder
-		.Key("total_time")
-		.Value(route_val.total_time)
-		.Key("items")
-		.StartArray();
-	auto& stops = request_handler.GetTransportCatalogue().GetStops();
-	auto& buses = request_handler.GetTransportCatalogue().GetBuses();
+
+	writer.StartDict().Key("items").StartArray();
 	for (auto& item : route_val.events) {
 		if (const router::Span* pval = std::get_if<router::Span>(&item)) {
-
-			auto node = Builder{}
+			writer
 				.StartDict()
-				.Key("bus").Value(buses[pval->bus].name_)
+				.Key("bus").Value(request_handler_.GetBusName(pval->bus))
 				.Key("span_count").Value(static_cast<int>(pval->count))
 				.Key("time").Value(pval->time)
-				.Key("type").Value("Bus"s)
-				.EndDict()
-				.Build();
-
-			items.Value(node
-				.AsDict());
+				.Key("type").Value("Bus")
+				.EndDict();
 		}
 		else if (const router::Wait* pval = std::get_if<router::Wait>(&item)) {
-			auto node = Builder{}
+			writer
 				.StartDict()
-				.Key("stop_name").Value(stops[pval->stop].name_)
+				.Key("stop_name").Value(request_handler_.GetStopName(pval->stop))
 				.Key("time").Value(pval->time)
-				.Key("type").Value("Wait"s)
-				.EndDict()
-				.Build();
-
-			items.Value(node
-				.AsDict());
+				.Key("type").Value("Wait")
+				.EndDict();
 		}
 	}
-	return items
+	writer
 		.EndArray()
-		.EndDict()
-		.Build();
+		.Key("request_id").Value(request.at("id").AsInt())
+		.Key("total_time").Value(route_val.total_time)
+		.EndDict();
 }
 
 
+// { "latitude", "longitude", "radius" (метры) и/или "count" }; в ответе остановки по возрастанию расстояния
+void StatReader::NearestStopsRequest(const Dict& request, Writer& writer) const {
+	const geo::Coordinates center{ request.at("latitude"s).AsDouble(), request.at("longitude"s).AsDouble() };
+	std::optional<double> radius;
+	std::optional<size_t> count;
+	if (auto it = request.find("radius"s); it != request.end()) {
+		radius = it->second.AsDouble();
+		if (*radius < 0) {
+			throw std::logic_error("NearestStops radius must not be negative"s);
+		}
+	}
+	if (auto it = request.find("count"s); it != request.end()) {
+		const int value = it->second.AsInt();
+		if (value < 0) {
+			throw std::logic_error("NearestStops count must not be negative"s);
+		}
+		count = static_cast<size_t>(value);
+	}
+	if (!radius && !count) {
+		throw std::logic_error("NearestStops needs radius or count"s);
+	}
+
+	writer
+		.StartDict()
+		.Key("request_id").Value(request.at("id").AsInt())
+		.Key("stops").StartArray();
+	for (const StopIndex::Found& found : request_handler_.FindNearestStops(center, radius, count)) {
+		writer
+			.StartDict()
+			.Key("distance").Value(found.distance)
+			.Key("name").Value(request_handler_.GetStopName(found.stop_id))
+			.EndDict();
+	}
+	writer
+		.EndArray()
+		.EndDict();
+}
+
 } //namespace json
 } //namespace transport
\ No newline at end of file
@@ -1,12 +1,23 @@
 #pragma once
 
+#include <limits>
+#include <map>
+#include <memory>
 #include <optional>
+#include <ostream>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
 
 #include "json.h"
+#include "json_writer.h"
 #include "transport_catalogue.h"
 #include "map_renderer.h"
 #include "transport_router.h"
 #include "request_handler.h"
+#include "flat_base.h"
+#include "parallel.h"
 
 
 namespace transport {
@@ -16,6 +27,8 @@ using ::json::Node;
 using ::json::Document;
 using ::json::Array;
 using ::json::Dict;
+using ::json::ArenaNode;
+using ::json::ArenaDocument;
 using ::transport::router::Router;
 using ::transport::router::RouterSettings;
 using ::transport::renderer::RenderSettings;
@@ -24,36 +37,102 @@ struct Base {
 	transport::TransportCatalogue transport_catalogue;
 	RenderSettings render_settings;
 	Router router;
+	// Готовая SVG карты: отрисовывается один раз при make_base и хранится в базе.
+	// Пуста для баз, записанных без карты
+	std::string map;
 };
 
+// База, по которой отвечают на stat_requests: собранная в памяти или плоская, отображённая в память.
+// QueryBase держит отображение файла и не перемещается, поэтому лежит в unique_ptr
+using StatBase = std::variant<Base, std::unique_ptr<flat::QueryBase>>;
+
+// Входные данные базы читаются из ArenaDocument: их много, а живут они только до построения базы
 class BaseReader {
 public:
-	Base operator()(const Document& document);
+	Base operator()(const ArenaDocument& document);
 private:
 	transport::TransportCatalogue transport_catalogue_;
 	RenderSettings render_settings_;
 	RouterSettings router_settings_;
 	std::optional<Router> router_;
 
-	void InputReader(const Node& input_node);
+	void InputReader(const ArenaNode& input_node);
 	
 };
 
-class StatReader {
+// Применяет к загруженной базе изменения из документа update_base. В base_requests те же запросы Stop и Bus,
+// что и в make_base: новая остановка или автобус добавляются, существующие заменяются, а с "remove": true удаляются.
+// У существующей остановки координаты можно не указывать, её road_distances дополняют уже заданные расстояния.
+// Повторные запросы Stop с одним именем сливаются, у Bus действует последний.
+// Необязательные render_settings и routing_settings заменяют сохранённые в базе.
+// Статистика считается заново только для затронутых автобусов, рёбра графа остальных переносятся из старой базы.
+// Карта сохраняется, если не изменились остановки, автобусы и настройки отрисовки, иначе отрисовывается заново
+class BaseUpdater {
 public:
-	StatReader(const Base& base);
-	Document operator()(const Document& document);
+	Base operator()(Base base, const ArenaDocument& document);
 private:
-	const Base& base_;
+	static constexpr size_t NO_ID = std::numeric_limits<size_t>::max();
+
+	// Все запросы Stop по одному имени: координаты из последнего, где они заданы, road_distances объединены,
+	// для одной и той же остановки действует последнее расстояние. Удаление нельзя смешивать с изменением
+	struct StopRequest {
+		bool remove = false;
+		std::optional<geo::Coordinates> coordinates;
+		std::map<std::string_view, size_t> road_distances;
+	};
+
+	// Запросы по каждому имени и порядок первого появления имён: в нём добавляются новые остановки и автобусы
+	std::unordered_map<std::string_view, StopRequest> stop_requests_;
+	std::vector<std::string_view> stop_order_;
+	std::unordered_map<std::string_view, const ArenaNode*> bus_requests_;
+	std::vector<std::string_view> bus_order_;
+
+	transport::TransportCatalogue transport_catalogue_;
+	// id остановки старой базы -> id в новом каталоге, NO_ID для удалённой
+	std::vector<size_t> stop_ids_;
+	// По id нового каталога: остановка новая или у неё изменились координаты
+	std::vector<bool> moved_stops_;
+	// По id нового каталога: изменилось расстояние от остановки или до неё
+	std::vector<bool> touched_stops_;
+	// По id нового автобуса: id в старой базе, NO_ID для нового или заменённого
+	std::vector<size_t> previous_bus_ids_;
+	bool stops_changed_ = false;
+	bool buses_changed_ = false;
 
-	Node StatRequests(const Node& stat_node);
-	Node StatRequests(const Node& stat_node, const RequestHandler& request_handler);
+	void ReadRequests(const ArenaNode& input_node);
+	void UpdateStops(const TransportCatalogue& previous);
+	void UpdateRoadDistances(const TransportCatalogue& previous);
+	void UpdateBuses(const TransportCatalogue& previous);
+	void UpdateBusStats(const TransportCatalogue& previous);
+	// Для каждого автобуса id в старой базе, если его рёбра можно перенести, иначе GraphBuilder::NO_BUS
+	std::vector<size_t> GetEdgeSources() const;
+	size_t GetStopId(std::string_view name) const;
+};
+
+// Запросы независимы и только читают базу, поэтому отвечаем на них пачками по BATCH_SIZE
+// на thread_count потоках; ответы выводятся в исходном порядке
+class StatReader {
+public:
+	static constexpr size_t BATCH_SIZE = 4096;
+
+	StatReader(const StatBase& base, size_t thread_count = parallel::GetDefaultThreadCount());
+	// Отвечает на запросы, печатая ответы по мере готовности, а не после разбора всего массива.
+	// Разборщик должен стоять перед значением stat_requests
+	void operator()(::json::Parser& parser, std::ostream& output) const;
+	// Можно вызывать из нескольких потоков одновременно
+	void operator()(const Node& stat_requests, std::ostream& output) const;
+private:
+	RequestHandler request_handler_;
+	size_t thread_count_;
 
-	Node StatRequest(const Dict& request, const RequestHandler& request_handler);
-	Node BusRequest(const Dict& request, const RequestHandler& request_handler);
-	Node StopRequest(const Dict& request, const RequestHandler& request_handler);
-	Node MapRequest(const Dict& request, const RequestHandler& request_handler);
-	Node RouteRequest(const Dict& request, const RequestHandler& request_handler);
+	void AnswerBatch(const Node* begin, const Node* end, ::json::Writer& writer) const;
+	void StatRequest(const Dict& request, ::json::Writer& writer) const;
+	void BusRequest(const Dict& request, ::json::Writer& writer) const;
+	void StopRequest(const Dict& request, ::json::Writer& writer) const;
+	void MapRequest(const Dict& request, ::json::Writer& writer) const;
+	void RouteRequest(const Dict& request, ::json::Writer& writer) const;
+	void NearestStopsRequest(const Dict& request, ::json::Writer& writer) const;
+	void NotFound(const Dict& request, ::json::Writer& writer) const;
 };
 }
 }
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include "json_writer.h"
+
+#include <stdexcept>
+
+namespace json {
+
+Writer::Writer(std::ostream& output)
+    : output_(output) {
+}
+
+bool Writer::IsReady() const {
+    return ready_;
+}
+
+void Writer::BeforeValue() {
+    if (ready_) {
+        throw std::logic_error("Object already ready");
+    }
+    if (context_stack_.empty()) {
+        return;
+    }
+    Frame& frame = context_stack_.back();
+    if (frame.is_dict) {
+        if (!frame.after_key) {
+            throw std::logic_error("Set value for invalid Node");
+        }
+        frame.after_key = false;
+        return;
+    }
+    if (!frame.first) {
+        output_ << ',';
+    }
+    frame.first = false;
+}
+
+Writer& Writer::Key(std::string_view key) {
+    if (context_stack_.empty() || !context_stack_.back().is_dict || context_stack_.back().after_key) {
+        throw std::logic_error("Call Key for not Dict");
+    }
+    Frame& frame = context_stack_.back();
+    if (!frame.first) {
+        output_ << ", ";
+    }
+    frame.first = false;
+    frame.after_key = true;
+    PrintString(key, output_);
+    output_ << ": ";
+    return *this;
+}
+
+Writer& Writer::Value(std::nullptr_t) {
+    BeforeValue();
+    output_ << "null";
+    ready_ = context_stack_.empty();
+    return *this;
+}
+
+Writer& Writer::Value(bool value) {
+    BeforeValue();
+    output_ << (value ? "true" : "false");
+    ready_ = context_stack_.empty();
+    return *this;
+}
+
+Writer& Writer::Value(int value) {
+    BeforeValue();
+    output_ << value;
+    ready_ = context_stack_.empty();
+    return *this;
+}
+
+Writer& Writer::Value(double value) {
+    BeforeValue();
+    output_ << value;
+    ready_ = context_stack_.empty();
+    return *this;
+}
+
+Writer& Writer::Value(std::string_view value) {
+    BeforeValue();
+    PrintString(value, output_);
+    ready_ = context_stack_.empty();
+    return *this;
+}
+
+Writer& Writer::Value(const char* value) {
+    return Value(std::string_view{ value });
+}
+
+Writer& Writer::Value(const std::string& value) {
+    return Value(std::string_view{ value });
+}
+
+Writer& Writer::Value(const Node& node) {
+    BeforeValue();
+    node.Print(output_);
+    ready_ = context_stack_.empty();
+    return *this;
+}
+
+Writer& Writer::RawValue(std::string_view json) {
+    BeforeValue();
+    output_ << json;
+    ready_ = context_stack_.empty();
+    return *this;
+}
+
+Writer& Writer::StartDict() {
+    BeforeValue();
+    output_ << "{ ";
+    context_stack_.push_back({ true });
+    return *this;
+}
+
+Writer& Writer::EndDict() {
+    if (context_stack_.empty() || !context_stack_.back().is_dict || context_stack_.back().after_key) {
+        throw std::logic_error("End dict for invalid Node");
+    }
+    output_ << " }";
+    context_stack_.pop_back();
+    ready_ = context_stack_.empty();
+    return *this;
+}
+
+Writer& Writer::StartArray() {
+    BeforeValue();
+    output_ << '[';
+    context_stack_.push_back({ false });
+    return *this;
+}
+
+Writer& Writer::EndArray() {
+    if (context_stack_.empty() || context_stack_.back().is_dict) {
+        throw std::logic_error("End array for invalid Node");
+    }
+    output_ << ']';
+    context_stack_.pop_back();
+    ready_ = context_stack_.empty();
+    return *this;
+}
+
+}//namespace json
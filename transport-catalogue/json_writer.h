@@ -0,0 +1,51 @@
+#pragma once
+
+#include "json.h"
+
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+namespace json {
+
+    // Пишет JSON сразу в поток, не строя дерево Node. Вызовы те же, что у Builder:
+    // StartDict/Key/Value/EndDict и StartArray/Value/EndArray; формат вывода совпадает с Node::Print.
+    // Ключи выводятся в порядке вызовов Key
+    class Writer {
+    public:
+        explicit Writer(std::ostream& output);
+
+        Writer& Key(std::string_view key);
+        Writer& Value(std::nullptr_t);
+        Writer& Value(bool value);
+        Writer& Value(int value);
+        Writer& Value(double value);
+        Writer& Value(std::string_view value);
+        Writer& Value(const char* value);
+        Writer& Value(const std::string& value);
+        Writer& Value(const Node& node);
+        // Вставляет уже сериализованное значение как есть, например ответ, собранный другим Writer
+        Writer& RawValue(std::string_view json);
+        Writer& StartDict();
+        Writer& EndDict();
+        Writer& StartArray();
+        Writer& EndArray();
+
+        // true, когда корневое значение записано полностью
+        bool IsReady() const;
+
+    private:
+        struct Frame {
+            bool is_dict;
+            bool first = true;
+            bool after_key = false;
+        };
+
+        std::ostream& output_;
+        std::vector<Frame> context_stack_;
+        bool ready_ = false;
+
+        void BeforeValue();
+    };
+
+}//namespace json
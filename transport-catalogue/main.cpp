@@ -5,8 +5,12 @@
 #include <string_view>
 #include "json_reader.h"
 #include "serialization.h"
+#include "flat_base.h"
+#include "server.h"
 #include "json.h"
+#include <charconv>
 #include <filesystem>
+#include <optional>
 
 using namespace std;
 using namespace transport;
@@ -17,59 +21,261 @@ using namespace transport;
 using namespace std::literals;
 
 void PrintUsage(std::ostream& stream = std::cerr) {
-    stream << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+    stream << "Usage: transport_catalogue [make_base|update_base|process_requests [--threads=N]|serve [--threads=N]]\n"sv;
 }
 
-int make_base(const ::json::Document& document, const std::filesystem::path& db_path) {
+transport::serialize::SerializationSettings ParseSerializationSettings(const ::json::ArenaDocument& document) {
+	const auto settings_dict = document.GetRoot()
+	.AsDict().at("serialization_settings")
+	.AsDict();
+
+	transport::serialize::SerializationSettings settings;
+	if (auto it = settings_dict.find("store_routes"); it != settings_dict.end()) {
+		settings.store_routes = it->value.AsBool();
+	}
+	if (auto it = settings_dict.find("format"); it != settings_dict.end()) {
+		const std::string_view format = it->value.AsString();
+		if (format == "protobuf"s) {
+			settings.format = transport::serialize::BaseFormat::PROTOBUF;
+		}
+		else if (format == "flat"s) {
+			settings.format = transport::serialize::BaseFormat::FLAT;
+		}
+		else {
+			throw std::runtime_error("Unknown serialization format: "s + std::string(format));
+		}
+	}
+	return settings;
+}
+
+// База пишется во временный файл рядом с db_path и подменяет старую переименованием,
+// так что читающий её процесс видит либо старую, либо новую базу целиком
+void SaveBase(const transport::json::Base& base, const transport::serialize::SerializationSettings& settings,
+	const std::filesystem::path& db_path) {
+	std::filesystem::path temp_path = db_path;
+	temp_path += ".tmp"s;
+	{
+		fstream file(temp_path, ios::binary | ios::out | ios::trunc);
+		if (settings.format == transport::serialize::BaseFormat::FLAT) {
+			transport::flat::SaveBaseTo(base.transport_catalogue, base.render_settings, base.router, base.map, file,
+				settings.store_routes);
+		}
+		else {
+			transport::serialize::SaveTransportCatalogueTo(base.transport_catalogue, base.render_settings, base.router,
+				base.map, file, settings);
+		}
+		file.flush();
+		if (!file) {
+			throw std::runtime_error("Failed to write data base: "s + temp_path.string());
+		}
+	}
+	std::filesystem::rename(temp_path, db_path);
+}
+
+int make_base(const ::json::ArenaDocument& document, const std::filesystem::path& db_path) {
 	transport::json::BaseReader reader{};
 
 	auto base = reader(document);
-	fstream file(db_path, ios::binary | ios::out);
-	transport::serialize::SaveTransportCatalogueTo(base.transport_catalogue, base.render_settings, base.router, file);
+	SaveBase(base, ParseSerializationSettings(document), db_path);
 	return 0;
 }
 
-int process_requests(const ::json::Document& document, const std::filesystem::path& db_path) {
+// В stored_routes, если он задан, записывается, сохранены ли в базе предрасчитанные маршруты
+transport::json::Base LoadBase(const std::filesystem::path& db_path, bool* stored_routes = nullptr) {
+	if (transport::flat::IsFlatBase(db_path)) {
+		transport::flat::MappedBase mapped{ db_path };
+		if (stored_routes) {
+			*stored_routes = mapped.HasStoredRoutes();
+		}
+		return transport::json::Base{
+			mapped.MakeTransportCatalogue(),
+			mapped.GetRenderSettings(),
+			mapped.MakeRouter(),
+			std::string(mapped.GetMap())
+		};
+	}
+
 	fstream file(db_path, ios::binary | ios::in);
 	transport::serialize::Base load;
 
 	if (!load.ParseFromIstream(&file)) {
 		throw std::logic_error("Data base is broken");
 	}
+	if (stored_routes) {
+		*stored_routes = transport::serialize::HasStoredRoutes(load.router());
+	}
 
-	transport::json::Base base{
+	return transport::json::Base{
 		transport::serialize::DeserializeTransportCatalogue(load.transport_catalogue()),
 		transport::serialize::DeserializeRenderSettings(load.render_settings()),
-		transport::serialize::DeserializeRouter(load.router())
+		transport::serialize::DeserializeRouter(load.router()),
+		std::move(*load.mutable_map())
 	};
+}
+
+// Для ответов на запросы плоская база не пересобирается в память, а отображается как есть
+transport::json::StatBase LoadStatBase(const std::filesystem::path& db_path) {
+	if (transport::flat::IsFlatBase(db_path)) {
+		return std::make_unique<transport::flat::QueryBase>(db_path);
+	}
+	return LoadBase(db_path);
+}
+
+template <typename JsonNode>
+std::filesystem::path GetDbPath(const JsonNode& serialization_settings) {
+	return serialization_settings.AsDict().at("file").AsString();
+}
+
+// Изменения применяются к базе из file. Новая база пишется в output_file, а без него — на место старой.
+// Без явных format и store_routes сохраняются формат старой базы и то, хранила ли она маршруты
+int update_base(const ::json::ArenaDocument& document) {
+	const auto settings_dict = document.GetRoot().AsDict().at("serialization_settings").AsDict();
+	const std::filesystem::path db_path = settings_dict.at("file").AsString();
+	std::filesystem::path output_path = db_path;
+	if (auto it = settings_dict.find("output_file"); it != settings_dict.end()) {
+		output_path = it->value.AsString();
+	}
+
+	auto settings = ParseSerializationSettings(document);
+	if (settings_dict.count("format") == 0 && transport::flat::IsFlatBase(db_path)) {
+		settings.format = transport::serialize::BaseFormat::FLAT;
+	}
+
+	bool stored_routes = false;
+	auto base = transport::json::BaseUpdater{}(LoadBase(db_path, &stored_routes), document);
+	if (settings_dict.count("store_routes") == 0) {
+		settings.store_routes = stored_routes;
+	}
+	SaveBase(base, settings, output_path);
+	return 0;
+}
+
+// Запросы разбираются потоком. Если serialization_settings идут раньше stat_requests,
+// ответы печатаются по мере разбора запросов и весь массив в памяти не держится,
+// иначе stat_requests приходится сначала прочитать целиком
+int process_requests(std::istream& input, size_t thread_count) {
+	using Event = ::json::Parser::Event;
+	::json::Parser parser{ input };
+	if (parser.Next() != Event::START_DICT) {
+		throw ::json::ParsingError("Root must be a dict"s);
+	}
+
+	std::optional<transport::json::StatBase> base;
+	std::optional<::json::Node> stat_requests;
+	bool answered = false;
+	while (parser.Next() == Event::KEY) {
+		const std::string key = parser.GetKey();
+		if (key == "serialization_settings"s) {
+			base.emplace(LoadStatBase(GetDbPath(parser.ReadNode())));
+		}
+		else if (key == "stat_requests"s && base) {
+			transport::json::StatReader{ *base, thread_count }(parser, cout);
+			answered = true;
+		}
+		else if (key == "stat_requests"s) {
+			stat_requests = parser.ReadNode();
+		}
+		else {
+			parser.SkipValue();
+		}
+	}
+
+	if (!base) {
+		throw std::logic_error("serialization_settings not found");
+	}
+	if (stat_requests) {
+		transport::json::StatReader{ *base, thread_count }(*stat_requests, cout);
+	}
+	else if (!answered) {
+		throw std::logic_error("stat_requests not found");
+	}
+	return 0;
+}
 
-	transport::json::StatReader reader{ base };
+transport::server::ServerSettings ParseServerSettings(const ::json::Node& server_settings) {
+	const auto& settings_dict = server_settings.AsDict();
+	transport::server::ServerSettings settings;
+	if (auto it = settings_dict.find("socket"s); it != settings_dict.end()) {
+		settings.socket_path = it->second.AsString();
+	}
+	if (auto it = settings_dict.find("port"s); it != settings_dict.end()) {
+		const int port = it->second.AsInt();
+		if (port <= 0 || port > 65535) {
+			throw std::runtime_error("Invalid port: "s + std::to_string(port));
+		}
+		settings.port = static_cast<uint16_t>(port);
+	}
+	if (settings.socket_path.empty() == !settings.port) {
+		throw std::runtime_error("server_settings must contain either socket or port"s);
+	}
+	return settings;
+}
 
-	reader(document).GetRoot().Print(cout);
+// Настройки читаются из stdin: serialization_settings как у process_requests и server_settings
+// с путём Unix-сокета ("socket") или TCP-портом на 127.0.0.1 ("port").
+// При перезагрузке база читается заново из того же файла
+int serve(std::istream& input, size_t thread_count) {
+	const ::json::Document document = ::json::Load(input);
+	const auto& root = document.GetRoot().AsDict();
+	const transport::server::ServerSettings settings = ParseServerSettings(root.at("server_settings"s));
+	const std::filesystem::path db_path = GetDbPath(root.at("serialization_settings"s));
+	transport::server::Serve([db_path]() { return LoadStatBase(db_path); }, settings, thread_count);
 	return 0;
 }
 
+// Разбирает необязательный аргумент --threads=N; без него берётся число ядер
+std::optional<size_t> ParseThreadCount(int argc, char* argv[]) {
+	if (argc == 2) {
+		return parallel::GetDefaultThreadCount();
+	}
+	const std::string_view prefix = "--threads="sv;
+	const std::string_view arg = argv[2];
+	if (argc != 3 || arg.substr(0, prefix.size()) != prefix) {
+		return std::nullopt;
+	}
+	size_t thread_count = 0;
+	const std::string_view value = arg.substr(prefix.size());
+	const auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), thread_count);
+	if (ec != std::errc{} || ptr != value.data() + value.size() || thread_count == 0) {
+		return std::nullopt;
+	}
+	return thread_count;
+}
+
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
+    if (argc < 2) {
         PrintUsage();
         return 1;
     }
 
     const std::string_view mode(argv[1]);
-	
-	//загружая json сдесь мы делаем BaseReader/StatReader не зависимым от сериализации
-	::json::Document document = ::json::Load(cin);
-	std::filesystem::path db_path = document.GetRoot()
-	.AsDict().at("serialization_settings")
-	.AsDict().at("file")
-	.AsString();
+	std::ios::sync_with_stdio(false);
 
-    if (mode == "make_base"sv) {
-		return make_base(document, db_path);
+    if (mode == "make_base"sv && argc == 2) {
+		//загружая json сдесь мы делаем BaseReader/StatReader не зависимым от сериализации
+		::json::ArenaDocument document = ::json::LoadArena(cin);
+		return make_base(document, GetDbPath(document.GetRoot().AsDict().at("serialization_settings")));
     }
+	if (mode == "update_base"sv && argc == 2) {
+		::json::ArenaDocument document = ::json::LoadArena(cin);
+		return update_base(document);
+	}
 	if (mode == "process_requests"sv) {
-		return process_requests(document, db_path);
+		const auto thread_count = ParseThreadCount(argc, argv);
+		if (!thread_count) {
+			PrintUsage();
+			return 1;
+		}
+		return process_requests(cin, *thread_count);
     }
+	if (mode == "serve"sv) {
+		const auto thread_count = ParseThreadCount(argc, argv);
+		if (!thread_count) {
+			PrintUsage();
+			return 1;
+		}
+		return serve(cin, *thread_count);
+	}
 
     PrintUsage();
     return 1;
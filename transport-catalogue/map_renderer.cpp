@@ -1,5 +1,9 @@
 #include "map_renderer.h"
 #include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <numeric>
 #include <sstream>
 namespace transport {
 
@@ -31,15 +35,59 @@ svg::Color MapRender::ColorToSvg(const Color& color) {
 }
 
 void MapRender::Render(std::ostream& os) const {
-    document_.Render(os);
+    std::vector<size_t> buses(buses_.size());
+    std::iota(buses.begin(), buses.end(), 0);
+    std::vector<size_t> stops(stops_with_buses_.size());
+    std::iota(stops.begin(), stops.end(), 0);
+
+    constexpr double INF = std::numeric_limits<double>::infinity();
+    svg::StreamDocument document(os);
+    RenderLayers(document, buses, stops, Viewport{ { -INF, -INF }, { INF, INF } });
+    document.Finish();
 }
 
 std::string MapRender::Render() const {
-    std::stringstream result;
-    document_.Render(result);
+    std::ostringstream result;
+    Render(result);
     return result.str();
 }
 
+void MapRender::Render(std::ostream& os, const Viewport& viewport) const {
+    std::vector<size_t> buses;
+    for (size_t i = 0; i < buses_.size(); ++i) {
+        if (IsBusVisible(buses_[i], viewport)) {
+            buses.push_back(i);
+        }
+    }
+    // Кружок остановки виден и тогда, когда центр чуть за краем
+    const std::vector<size_t> stops = stop_index_.Find(viewport.Expanded(stop_radius_));
+
+    svg::StreamDocument document(os, svg::ViewBox{ viewport.min,
+        viewport.max.x - viewport.min.x, viewport.max.y - viewport.min.y });
+    RenderLayers(document, buses, stops, viewport);
+    document.Finish();
+}
+
+std::string MapRender::Render(const Viewport& viewport) const {
+    std::ostringstream result;
+    Render(result, viewport);
+    return result.str();
+}
+
+std::optional<Viewport> MapRender::GetTile(int z, int x, int y) const {
+    constexpr int MAX_ZOOM = 30;
+    if (z < 0 || z > MAX_ZOOM) {
+        return std::nullopt;
+    }
+    const int64_t tiles = int64_t{ 1 } << z;
+    if (x < 0 || y < 0 || x >= tiles || y >= tiles) {
+        return std::nullopt;
+    }
+    const double tile_width = width_ / static_cast<double>(tiles);
+    const double tile_height = height_ / static_cast<double>(tiles);
+    return Viewport{ { x * tile_width, y * tile_height }, { (x + 1) * tile_width, (y + 1) * tile_height } };
+}
+
 bool IsZero(double value) {
     return std::abs(value) < EPSILON;
 }
@@ -51,31 +99,159 @@ svg::Point SphereProjector::operator()(geo::Coordinates coords) const {
     };
 }
 
-void MapRender::AddLines() {
-    size_t color_palette_counter = 0;
-    for (const Bus* bus : buses_) {
-        if (bus->stops_.size()) {
-            svg::Polyline polyline;
-            for (const Stop* stop : bus->stops_) {
-                polyline.AddPoint((*sphere_projector_)(stop->coordinates_));
-            }
-            if (!bus->circular_) {
-                auto it = bus->stops_.crbegin();
-                for (++it; it != bus->stops_.crend(); ++it) {
-                    polyline.AddPoint((*sphere_projector_)((*it)->coordinates_));
+bool Viewport::Contains(svg::Point point) const {
+    return point.x >= min.x && point.x <= max.x && point.y >= min.y && point.y <= max.y;
+}
+
+bool Viewport::Intersects(const Viewport& other) const {
+    return other.min.x <= max.x && other.max.x >= min.x && other.min.y <= max.y && other.max.y >= min.y;
+}
+
+// Отсечение Лианга — Барски: сужаем отрезок параметров [t0, t1] по каждой из четырёх границ
+bool Viewport::Intersects(svg::Point from, svg::Point to) const {
+    const double dx = to.x - from.x;
+    const double dy = to.y - from.y;
+    double t0 = 0;
+    double t1 = 1;
+    auto clip = [&t0, &t1](double p, double q) {
+        if (p == 0) {
+            return q >= 0;
+        }
+        const double t = q / p;
+        if (p < 0) {
+            t0 = std::max(t0, t);
+        }
+        else {
+            t1 = std::min(t1, t);
+        }
+        return t0 <= t1;
+    };
+    return clip(-dx, from.x - min.x) && clip(dx, max.x - from.x)
+        && clip(-dy, from.y - min.y) && clip(dy, max.y - from.y);
+}
+
+Viewport Viewport::Expanded(double margin) const {
+    return { { min.x - margin, min.y - margin }, { max.x + margin, max.y + margin } };
+}
+
+GridIndex::GridIndex(std::vector<svg::Point> points)
+    : points_(std::move(points)) {
+    if (points_.empty()) {
+        return;
+    }
+    Viewport bounds{ points_.front(), points_.front() };
+    for (const svg::Point& point : points_) {
+        bounds.min = { std::min(bounds.min.x, point.x), std::min(bounds.min.y, point.y) };
+        bounds.max = { std::max(bounds.max.x, point.x), std::max(bounds.max.y, point.y) };
+    }
+
+    // Около четырёх точек на ячейку
+    const size_t side = std::max<size_t>(1, static_cast<size_t>(std::sqrt(points_.size() / 4.0)));
+    min_ = bounds.min;
+    columns_ = side;
+    rows_ = side;
+    cell_width_ = IsZero(bounds.max.x - bounds.min.x) ? 1 : (bounds.max.x - bounds.min.x) / side;
+    cell_height_ = IsZero(bounds.max.y - bounds.min.y) ? 1 : (bounds.max.y - bounds.min.y) / side;
+
+    cell_offsets_.assign(columns_ * rows_ + 1, 0);
+    std::vector<size_t> cells(points_.size());
+    for (size_t i = 0; i < points_.size(); ++i) {
+        cells[i] = GetRow(points_[i].y) * columns_ + GetColumn(points_[i].x);
+        ++cell_offsets_[cells[i] + 1];
+    }
+    std::partial_sum(cell_offsets_.begin(), cell_offsets_.end(), cell_offsets_.begin());
+
+    cell_items_.resize(points_.size());
+    std::vector<uint32_t> next(cell_offsets_.begin(), cell_offsets_.end() - 1);
+    for (size_t i = 0; i < points_.size(); ++i) {
+        cell_items_[next[cells[i]]++] = static_cast<uint32_t>(i);
+    }
+}
+
+const svg::Point& GridIndex::GetPoint(size_t index) const {
+    return points_.at(index);
+}
+
+size_t GridIndex::GetColumn(double x) const {
+    const double column = std::floor((x - min_.x) / cell_width_);
+    return static_cast<size_t>(std::clamp(column, 0.0, static_cast<double>(columns_ - 1)));
+}
+
+size_t GridIndex::GetRow(double y) const {
+    const double row = std::floor((y - min_.y) / cell_height_);
+    return static_cast<size_t>(std::clamp(row, 0.0, static_cast<double>(rows_ - 1)));
+}
+
+std::vector<size_t> GridIndex::Find(const Viewport& viewport) const {
+    std::vector<size_t> result;
+    if (points_.empty() || viewport.max.x < viewport.min.x || viewport.max.y < viewport.min.y) {
+        return result;
+    }
+    for (size_t row = GetRow(viewport.min.y); row <= GetRow(viewport.max.y); ++row) {
+        for (size_t column = GetColumn(viewport.min.x); column <= GetColumn(viewport.max.x); ++column) {
+            const size_t cell = row * columns_ + column;
+            for (uint32_t i = cell_offsets_[cell]; i < cell_offsets_[cell + 1]; ++i) {
+                if (viewport.Contains(points_[cell_items_[i]])) {
+                    result.push_back(cell_items_[i]);
                 }
             }
-            polyline.
-                SetFillColor(svg::NoneColor).
-                SetStrokeColor(color_palette_[color_palette_counter]).
-                SetStrokeWidth(line_width_).
-                SetStrokeLineCap(svg::StrokeLineCap::ROUND).
-                SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+MapRender::MapRender(const RenderSettings& settings, const TransportCatalogue& transport_catalogue)
+    : transport_catalogue_{ transport_catalogue }
+    , width_{ settings.width }
+    , height_{ settings.height }
+    , line_width_{settings.line_width}
+    , bus_label_offset_{ settings.bus_label_offset.x,settings.bus_label_offset.y }
+    , bus_label_font_size_{ settings.bus_label_font_size }
+    , underlayer_color_{ ColorToSvg(settings.underlayer_color) }
+    , underlayer_width_{ settings.underlayer_width }
+    , stop_radius_{ settings.stop_radius }
+    , stop_label_offset_{ settings.stop_label_offset.x,settings.stop_label_offset.y }
+    , stop_label_font_size_{ settings.stop_label_font_size } {
+    std::vector<const Bus*> buses;
+    buses.reserve(transport_catalogue.GetBuses().size());
+    for (const Bus& bus : transport_catalogue.GetBuses()) {
+        buses.push_back(&bus);
+        stops_with_buses_.insert(stops_with_buses_.end(), bus.stops_set_.begin(), bus.stops_set_.end());
+    }
+    std::sort(buses.begin(), buses.end(), NameLess<Bus>{});
+    std::sort(stops_with_buses_.begin(), stops_with_buses_.end(), NameLess<Stop>{});
+    stops_with_buses_.erase(std::unique(stops_with_buses_.begin(), stops_with_buses_.end()), stops_with_buses_.end());
+
+    std::vector<geo::Coordinates> coordinates;
+    coordinates.reserve(stops_with_buses_.size());
+    for (const Stop* stop : stops_with_buses_) {
+        coordinates.push_back(stop->coordinates_);
+    }
+    sphere_projector_ = std::make_unique<SphereProjector>(coordinates.begin(), coordinates.end(),
+        settings.width, settings.height, settings.padding);
+    
+    FillColorPalette(settings.color_palette);
 
+    std::vector<svg::Point> stop_points;
+    stop_points.reserve(coordinates.size());
+    for (const geo::Coordinates& coords : coordinates) {
+        stop_points.push_back((*sphere_projector_)(coords));
+    }
+    stop_index_ = GridIndex(std::move(stop_points));
 
-            color_palette_counter = (color_palette_counter + 1) % color_palette_.size();
-            document_.Add(std::move(polyline));
+    for (const Bus* bus : buses) {
+        if (!bus->stops_count_) {
+            continue;
+        }
+        const svg::Point first = GetStopPoint(*transport_catalogue.GetBusStopIds(bus).begin());
+        Viewport bounds{ first, first };
+        for (size_t stop_id : transport_catalogue.GetBusStopIds(bus)) {
+            const svg::Point point = GetStopPoint(stop_id);
+            bounds.min = { std::min(bounds.min.x, point.x), std::min(bounds.min.y, point.y) };
+            bounds.max = { std::max(bounds.max.x, point.x), std::max(bounds.max.y, point.y) };
         }
+        buses_.push_back({ bus, buses_.size() % color_palette_.size(), bounds });
     }
 }
 
@@ -85,91 +261,129 @@ void MapRender::FillColorPalette(const std::vector<Color>& color_palette) {
     }
 }
 
-void MapRender::SetCommonBusTextSettings(svg::Text& text, const std::string_view bus_name, const svg::Point& position) {
-    text.SetPosition(position)
-        .SetOffset(bus_label_offset_)
-        .SetFontSize(static_cast<uint32_t>(bus_label_font_size_))
-        .SetFontFamily("Verdana")
-        .SetFontWeight("bold")
-        .SetData(std::string(bus_name));
+svg::PathAttrs MapRender::GetUnderlayerAttrs() const {
+    svg::PathAttrs attrs;
+    attrs.fill_color = underlayer_color_;
+    attrs.stroke_color = underlayer_color_;
+    attrs.stroke_width = underlayer_width_;
+    attrs.stroke_linecap = svg::StrokeLineCap::ROUND;
+    attrs.stroke_linejoin = svg::StrokeLineJoin::ROUND;
+    return attrs;
 }
 
-void MapRender::AddBusName(const std::string_view name, const Stop* stop, const svg::Color& color) {
-    svg::Text substrate;
-    svg::Text text;
-
-    svg::Point position = (*sphere_projector_)(stop->coordinates_);
-
-    SetCommonBusTextSettings(substrate, name, position);
-    SetCommonBusTextSettings(text, name, position);
+svg::Point MapRender::GetStopPoint(size_t stop_id) const {
+    return (*sphere_projector_)(transport_catalogue_.GetStopById(stop_id)->coordinates_);
+}
 
-    substrate.SetFillColor(underlayer_color_)
-        .SetStrokeColor(underlayer_color_)
-        .SetStrokeWidth(underlayer_width_)
-        .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
-        .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
-    text.SetFillColor(color);
-    document_.Add(std::move(substrate));
-    document_.Add(std::move(text));
+// Сначала грубая проверка по рамке маршрута, затем по отрезкам между соседними остановками
+bool MapRender::IsBusVisible(const BusLayout& layout, const Viewport& viewport) const {
+    if (!viewport.Intersects(layout.bounds)) {
+        return false;
+    }
+    const auto stop_ids = transport_catalogue_.GetBusStopIds(layout.bus);
+    svg::Point prev = GetStopPoint(*stop_ids.begin());
+    if (viewport.Contains(prev)) {
+        return true;
+    }
+    for (auto it = stop_ids.begin() + 1; it != stop_ids.end(); ++it) {
+        const svg::Point point = GetStopPoint(*it);
+        if (viewport.Intersects(prev, point)) {
+            return true;
+        }
+        prev = point;
+    }
+    return false;
 }
 
-void MapRender::AddBusNames() {
-    size_t color_palette_counter = 0;
-    for (const Bus* bus : buses_) {
-        if (bus->stops_.size()) {
+void MapRender::RenderLayers(svg::StreamDocument& document, const std::vector<size_t>& buses,
+    const std::vector<size_t>& stops, const Viewport& labels_viewport) const {
+    RenderLines(document, buses);
+    RenderBusNames(document, buses, labels_viewport);
+    RenderStopRounds(document, stops);
+    RenderStopNames(document, stops);
+}
 
-            AddBusName(bus->name_, bus->stops_.front(), color_palette_.at(color_palette_counter));
-            if (bus->stops_.front() != bus->stops_.back()) {
-                AddBusName(bus->name_, bus->stops_.back(), color_palette_.at(color_palette_counter));
+void MapRender::RenderLines(svg::StreamDocument& document, const std::vector<size_t>& buses) const {
+    svg::PathAttrs attrs;
+    attrs.fill_color = svg::NoneColor;
+    attrs.stroke_width = line_width_;
+    attrs.stroke_linecap = svg::StrokeLineCap::ROUND;
+    attrs.stroke_linejoin = svg::StrokeLineJoin::ROUND;
+
+    for (size_t index : buses) {
+        const BusLayout& layout = buses_[index];
+        const auto stop_ids = transport_catalogue_.GetBusStopIds(layout.bus);
+        document.StartPolyline();
+        for (size_t stop_id : stop_ids) {
+            document.AddPolylinePoint(GetStopPoint(stop_id));
+        }
+        if (!layout.bus->circular_) {
+            auto it = std::make_reverse_iterator(stop_ids.end());
+            for (++it; it != std::make_reverse_iterator(stop_ids.begin()); ++it) {
+                document.AddPolylinePoint(GetStopPoint(*it));
             }
-
-            color_palette_counter = (color_palette_counter + 1) % color_palette_.size();
         }
+        attrs.stroke_color = color_palette_[layout.color_index];
+        document.EndPolyline(attrs);
     }
 }
 
-void MapRender::AddStopRounds() {
-    for (const Stop* stop : stops_with_buses_) {
-
-        svg::Circle circle;
+void MapRender::RenderBusName(svg::StreamDocument& document, const std::string_view name, svg::Point position,
+    const svg::Color& color) const {
+    using namespace std::literals;
 
-        circle.SetCenter((*sphere_projector_)(stop->coordinates_))
-            .SetRadius(stop_radius_)
-            .SetFillColor("white");
+    const svg::TextAttrs text{ position, bus_label_offset_,
+        static_cast<uint32_t>(bus_label_font_size_), "Verdana"sv, "bold"sv };
+    svg::PathAttrs attrs;
+    attrs.fill_color = color;
 
-        document_.Add(std::move(circle));
-    }
-    
+    document.AddText(text, name, GetUnderlayerAttrs());
+    document.AddText(text, name, attrs);
 }
 
-void MapRender::SetCommonStopTextSettings(svg::Text& text, const std::string_view stop_name, const svg::Point& position) {
-    text.SetPosition(position)
-        .SetOffset(stop_label_offset_)
-        .SetFontSize(static_cast<uint32_t>(stop_label_font_size_))
-        .SetFontFamily("Verdana")
-        .SetData(std::string(stop_name));
+void MapRender::RenderBusNames(svg::StreamDocument& document, const std::vector<size_t>& buses,
+    const Viewport& labels_viewport) const {
+    for (size_t index : buses) {
+        const BusLayout& layout = buses_[index];
+        const auto stop_ids = transport_catalogue_.GetBusStopIds(layout.bus);
+        const size_t first_stop_id = *stop_ids.begin();
+        const size_t last_stop_id = *(stop_ids.end() - 1);
+
+        const svg::Color& color = color_palette_.at(layout.color_index);
+        if (const svg::Point point = GetStopPoint(first_stop_id); labels_viewport.Contains(point)) {
+            RenderBusName(document, layout.bus->name_, point, color);
+        }
+        if (first_stop_id != last_stop_id) {
+            if (const svg::Point point = GetStopPoint(last_stop_id); labels_viewport.Contains(point)) {
+                RenderBusName(document, layout.bus->name_, point, color);
+            }
+        }
+    }
 }
 
-void MapRender::AddStopNames() {
-    for (const Stop* stop : stops_with_buses_) {
-        svg::Text substrate;
-        svg::Text text;
-
-        svg::Point position = (*sphere_projector_)(stop->coordinates_);
+void MapRender::RenderStopRounds(svg::StreamDocument& document, const std::vector<size_t>& stops) const {
+    using namespace std::literals;
 
-        SetCommonStopTextSettings(substrate, stop->name_, position);
-        SetCommonStopTextSettings(text, stop->name_, position);
+    svg::PathAttrs attrs;
+    attrs.fill_color = "white"sv;
+    for (size_t index : stops) {
+        document.AddCircle(stop_index_.GetPoint(index), stop_radius_, attrs);
+    }
+}
 
-        substrate.SetFillColor(underlayer_color_)
-            .SetStrokeColor(underlayer_color_)
-            .SetStrokeWidth(underlayer_width_)
-            .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
-            .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+void MapRender::RenderStopNames(svg::StreamDocument& document, const std::vector<size_t>& stops) const {
+    using namespace std::literals;
 
-        text.SetFillColor("black");
+    const svg::PathAttrs underlayer_attrs = GetUnderlayerAttrs();
+    svg::PathAttrs attrs;
+    attrs.fill_color = "black"sv;
+    for (size_t index : stops) {
+        const svg::TextAttrs text{ stop_index_.GetPoint(index), stop_label_offset_,
+            static_cast<uint32_t>(stop_label_font_size_), "Verdana"sv, {} };
+        const std::string_view name = stops_with_buses_[index]->name_;
 
-        document_.Add(std::move(substrate));
-        document_.Add(std::move(text));
+        document.AddText(text, name, underlayer_attrs);
+        document.AddText(text, name, attrs);
     }
 }
 
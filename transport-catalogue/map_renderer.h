@@ -3,6 +3,7 @@
 #include "geo.h"
 #include "svg.h"
 #include "domain.h"
+#include "transport_catalogue.h"
 
 #include <algorithm>
 #include <cstdlib>
@@ -126,6 +127,43 @@ namespace renderer {
         double zoom_coeff_ = 0;
     };
 
+    // Прямоугольник в координатах SVG-карты
+    struct Viewport {
+        svg::Point min;
+        svg::Point max;
+
+        bool Contains(svg::Point point) const;
+        bool Intersects(const Viewport& other) const;
+        // Пересекает ли прямоугольник отрезок [from, to]
+        bool Intersects(svg::Point from, svg::Point to) const;
+        Viewport Expanded(double margin) const;
+    };
+
+    // Равномерная сетка над точками карты: поиск точек в прямоугольнике
+    // просматривает только ячейки, которые он задевает
+    class GridIndex {
+    public:
+        GridIndex() = default;
+        explicit GridIndex(std::vector<svg::Point> points);
+
+        const svg::Point& GetPoint(size_t index) const;
+        // Индексы точек внутри viewport по возрастанию
+        std::vector<size_t> Find(const Viewport& viewport) const;
+
+    private:
+        std::vector<svg::Point> points_;
+        svg::Point min_;
+        double cell_width_ = 1;
+        double cell_height_ = 1;
+        size_t columns_ = 0;
+        size_t rows_ = 0;
+        std::vector<uint32_t> cell_offsets_;// columns_ * rows_ + 1 элементов
+        std::vector<uint32_t> cell_items_;
+
+        size_t GetColumn(double x) const;
+        size_t GetRow(double y) const;
+    };
+
     template <typename Nameble>
     struct NameLess {
         bool operator()(const Nameble* lhs, const Nameble* rhs) const {
@@ -133,10 +171,11 @@ namespace renderer {
         }
     };
 
+    // Карта не хранится деревом svg-объектов: Render выводит слои прямо в поток через svg::StreamDocument.
+    // Справочник должен жить, пока используется MapRender
     class MapRender {
     public:
-        template <typename ForvardIt>
-        MapRender(const RenderSettings& settings, ForvardIt begin_buses, ForvardIt end_buses);
+        MapRender(const RenderSettings& settings, const TransportCatalogue& transport_catalogue);
 
 
 
@@ -145,12 +184,31 @@ namespace renderer {
         void Render(std::ostream& os) const;
         std::string Render() const;
 
+        // Часть карты: только маршруты и остановки, задевающие viewport, в тех же координатах
+        // и цветах, что и на полной карте. Видимая область документа ограничена viewport
+        void Render(std::ostream& os, const Viewport& viewport) const;
+        std::string Render(const Viewport& viewport) const;
+
+        // Тайл z/x/y: холст width x height делится на 2^z x 2^z равных частей.
+        // nullopt, если координаты тайла вне диапазона
+        std::optional<Viewport> GetTile(int z, int x, int y) const;
+
     private:
-        svg::Document document_;
+        // Маршрут с хотя бы одной остановкой
+        struct BusLayout {
+            const Bus* bus;
+            size_t color_index;// цвет из палитры в порядке имён, как на полной карте
+            Viewport bounds;
+        };
+
+        const TransportCatalogue& transport_catalogue_;
         std::unique_ptr<SphereProjector> sphere_projector_;
         std::vector<svg::Color> color_palette_;
-        std::set<const Bus*, NameLess<Bus>> buses_;
-        std::set<const Stop*, NameLess<Stop>> stops_with_buses_;
+        std::vector<BusLayout> buses_;// по имени
+        std::vector<const Stop*> stops_with_buses_;// по имени
+        GridIndex stop_index_;// точки stops_with_buses_ в том же порядке
+        double width_;
+        double height_;
         double line_width_;
         svg::Point bus_label_offset_;
         size_t bus_label_font_size_;
@@ -161,48 +219,25 @@ namespace renderer {
         size_t stop_label_font_size_;
 
         void FillColorPalette(const std::vector<Color>& color_palette);
-        void AddLines();
-
-        void SetCommonBusTextSettings(svg::Text& text, const std::string_view bus_name, const svg::Point& position);
-        void AddBusName(const std::string_view name, const Stop* stop, const svg::Color& color);
-        void AddBusNames();
-
-        void AddStopRounds();
-        void SetCommonStopTextSettings(svg::Text& text, const std::string_view stop_name, const svg::Point& position);
-        void AddStopNames();
+        svg::PathAttrs GetUnderlayerAttrs() const;
+
+        svg::Point GetStopPoint(size_t stop_id) const;
+        bool IsBusVisible(const BusLayout& layout, const Viewport& viewport) const;
+
+        // buses и stops — индексы в buses_ и stops_with_buses_; названия маршрутов выводятся
+        // только у конечных, попавших в labels_viewport
+        void RenderLayers(svg::StreamDocument& document, const std::vector<size_t>& buses,
+            const std::vector<size_t>& stops, const Viewport& labels_viewport) const;
+        void RenderLines(svg::StreamDocument& document, const std::vector<size_t>& buses) const;
+        void RenderBusName(svg::StreamDocument& document, const std::string_view name, svg::Point position,
+            const svg::Color& color) const;
+        void RenderBusNames(svg::StreamDocument& document, const std::vector<size_t>& buses,
+            const Viewport& labels_viewport) const;
+        void RenderStopRounds(svg::StreamDocument& document, const std::vector<size_t>& stops) const;
+        void RenderStopNames(svg::StreamDocument& document, const std::vector<size_t>& stops) const;
     };
 
 
 
-    template <typename ForvardIt>
-    MapRender::MapRender(const RenderSettings& settings, ForvardIt begin_buses, ForvardIt end_buses)
-        : line_width_{settings.line_width}
-        , bus_label_offset_{ settings.bus_label_offset.x,settings.bus_label_offset.y }
-        , bus_label_font_size_{ settings.bus_label_font_size }
-        , underlayer_color_{ ColorToSvg(settings.underlayer_color) }
-        , underlayer_width_{ settings.underlayer_width }
-        , stop_radius_{ settings.stop_radius }
-        , stop_label_offset_{ settings.stop_label_offset.x,settings.stop_label_offset.y }
-        , stop_label_font_size_{ settings.stop_label_font_size } {
-        std::list<geo::Coordinates> coordinates;
-
-        for (auto it = begin_buses; it != end_buses; ++it) {
-            buses_.insert((&(*it)));
-            for (const Stop* stop : it->stops_set_) {
-                coordinates.push_back(stop->coordinates_);
-                stops_with_buses_.insert(stop);
-            }
-        }
-        
-        sphere_projector_ = std::make_unique<SphereProjector>(coordinates.begin(), coordinates.end(),
-            settings.width, settings.height, settings.padding);
-        
-        FillColorPalette(settings.color_palette);
-
-        AddLines();
-        AddBusNames();
-        AddStopRounds();
-        AddStopNames();
-    }
 }//namespace renderer 
 }//namespace transport 
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+    // Число потоков по умолчанию: по числу ядер, но не меньше одного
+    inline size_t GetDefaultThreadCount() {
+        return std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+
+    // Вызывает func(i) для всех i из [0, count) на пуле из thread_count потоков.
+    // Потоки разбирают индексы по одному из общего счётчика, поэтому неравные по стоимости
+    // задачи распределяются сами. Порядок вызовов не определён: результат записывайте по индексу.
+    // Первое исключение из func пробрасывается после завершения всех потоков
+    template <typename Func>
+    void ForEachIndex(size_t count, Func func, size_t thread_count = GetDefaultThreadCount()) {
+        thread_count = std::min(thread_count, count);
+        if (thread_count <= 1) {
+            for (size_t i = 0; i < count; ++i) {
+                func(i);
+            }
+            return;
+        }
+
+        std::atomic<size_t> next_index{ 0 };
+        std::exception_ptr error;
+        std::mutex error_mutex;
+
+        auto worker = [&]() {
+            for (size_t i = next_index++; i < count; i = next_index++) {
+                try {
+                    func(i);
+                }
+                catch (...) {
+                    std::lock_guard lock(error_mutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                    next_index = count;
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(thread_count - 1);
+        for (size_t i = 1; i < thread_count; ++i) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+}  // namespace parallel
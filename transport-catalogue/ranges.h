@@ -1,9 +1,13 @@
 #pragma once
 
+#include <cstddef>
 #include <iterator>
+#include <stdexcept>
 #include <string_view>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 namespace ranges {
 
@@ -33,4 +37,86 @@ namespace ranges {
         return Range{ container.begin(), container.end() };
     }
 
+    // Неизменяемый массив, который либо владеет элементами, либо ссылается на чужую память,
+    // например на отображённую в память базу. Копия ссылающегося массива ссылается на ту же память,
+    // поэтому она должна жить дольше всех копий
+    template <typename T>
+    class Storage {
+    public:
+        Storage() = default;
+        Storage(std::vector<T> items)
+            : items_(std::move(items))
+            , data_(items_.data())
+            , size_(items_.size()) {
+        }
+
+        static Storage Borrow(const T* data, size_t size) {
+            Storage ret;
+            ret.data_ = data;
+            ret.size_ = size;
+            ret.borrowed_ = true;
+            return ret;
+        }
+
+        Storage(const Storage& other)
+            : items_(other.items_)
+            , data_(other.borrowed_ ? other.data_ : items_.data())
+            , size_(other.size_)
+            , borrowed_(other.borrowed_) {
+        }
+
+        // Буфер вектора при перемещении не меняется, так что data_ остаётся верным
+        Storage(Storage&& other) noexcept
+            : items_(std::move(other.items_))
+            , data_(std::exchange(other.data_, nullptr))
+            , size_(std::exchange(other.size_, 0))
+            , borrowed_(std::exchange(other.borrowed_, false)) {
+        }
+
+        Storage& operator=(Storage other) noexcept {
+            std::swap(items_, other.items_);
+            std::swap(data_, other.data_);
+            std::swap(size_, other.size_);
+            std::swap(borrowed_, other.borrowed_);
+            return *this;
+        }
+
+        const T* data() const {
+            return data_;
+        }
+        size_t size() const {
+            return size_;
+        }
+        bool empty() const {
+            return size_ == 0;
+        }
+        const T* begin() const {
+            return data_;
+        }
+        const T* end() const {
+            return data_ + size_;
+        }
+        const T& operator[](size_t index) const {
+            return data_[index];
+        }
+        const T& at(size_t index) const {
+            if (index >= size_) {
+                throw std::out_of_range("Storage index out of range");
+            }
+            return data_[index];
+        }
+        const T& front() const {
+            return data_[0];
+        }
+        const T& back() const {
+            return data_[size_ - 1];
+        }
+
+    private:
+        std::vector<T> items_;
+        const T* data_ = nullptr;
+        size_t size_ = 0;
+        bool borrowed_ = false;
+    };
+
 }  // namespace ranges
\ No newline at end of file
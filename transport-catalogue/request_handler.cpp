@@ -4,73 +4,148 @@
 
 namespace transport {
 
-RequestHandler::RequestHandler(const TransportCatalogue& db, const renderer::MapRender& renderer, const router::Router& router)
-	: db_{ db } 
-	, renderer_{ renderer }
-	, router_{ router } {
+RequestHandler::RequestHandler(const TransportCatalogue& db, const renderer::RenderSettings& render_settings,
+	const std::string& map, const router::Router& router)
+	: db_{ &db } 
+	, render_settings_{ render_settings }
+	, map_{ map }
+	, router_{ router }
+	, stop_index_{ db.GetStopIndex() } {
+}
+
+RequestHandler::RequestHandler(const flat::QueryBase& base)
+	: mapped_{ &base.GetData() }
+	, render_settings_{ base.GetRenderSettings() }
+	, map_{ base.GetData().GetMap() }
+	, router_{ base.GetRouter() }
+	, stop_index_{ base.GetStopIndex() } {
 }
 
 // Возвращает информацию о маршруте (запрос Bus)
 std::optional<BusStat> RequestHandler::GetBusStat(const std::string_view bus_name) const {
-	const Bus* bus = db_.GetBus(bus_name);
+	if (mapped_) {
+		const auto bus_id = mapped_->FindBus(bus_name);
+		if (!bus_id) {
+			return std::nullopt;
+		}
+		return mapped_->GetBusStat(*bus_id);
+	}
+
+	const Bus* bus = db_->GetBus(bus_name);
 	if (!bus) {
 		return std::optional<BusStat>{};
 	}
 
-	BusStat ret;
-	ret.route_length = db_.GetLength(bus);
-	ret.curvature = ret.route_length / db_.GetGeoLength(bus);
-	ret.stop_count = db_.GetStopsCount(bus);
-	ret.unique_stop_count = db_.GetUniqueStopsCount(bus);
-
-	return ret;
+	return db_->GetBusStat(bus);
 }
 
 // Возвращает маршруты, проходящие через
-const std::unordered_set<BusPtr>* RequestHandler::GetBusesByStop(const std::string_view& stop_name) const {
-	const Stop* pstop = db_.GetStop(stop_name);
-
-	if (!pstop) {
-		return nullptr;
+const std::optional <std::set<std::string_view>> RequestHandler::GetSortedBusesByStop(const std::string_view stop_name) const {
+	std::set<std::string_view> ret_set;
+	if (mapped_) {
+		const auto stop_id = mapped_->FindStop(stop_name);
+		if (!stop_id) {
+			return std::nullopt;
+		}
+		for (uint32_t bus_id : mapped_->GetStopBuses(*stop_id)) {
+			ret_set.insert(mapped_->GetBusName(bus_id));
+		}
+		return ret_set;
 	}
 
-	return db_.GetBusesByStop(pstop);
-}
-
-const std::optional <std::set<std::string_view>> RequestHandler::GetSortedBusesByStop(const std::string_view stop_name) const {
-	auto buses = GetBusesByStop(stop_name);
-	
-	if (!buses) {
+	const Stop* pstop = db_->GetStop(stop_name);
+	if (!pstop) {
 		return std::optional <std::set<std::string_view>>{};
 	}
 
-	std::set<std::string_view> ret_set;
-	for (auto pbus : *buses) {
+	for (auto pbus : *db_->GetBusesByStop(pstop)) {
 		ret_set.insert(pbus->name_);
 	}
 	return ret_set;
 }
 
 std::optional<Router::RouteInfo> RequestHandler::BuildRoute(const std::string_view from, const std::string_view to) const {
-	size_t stop_from = db_.GetStopIndex(from);
-	size_t stop_to = db_.GetStopIndex(to);
-
-	{
-		size_t fail = db_.GetStops().size();
-		if (stop_from == fail || stop_to == fail) {
+	if (mapped_) {
+		const auto from_id = mapped_->FindStop(from);
+		const auto to_id = mapped_->FindStop(to);
+		if (!from_id || !to_id) {
 			return {};
 		}
+		return router_.BuildRoute(*from_id, *to_id);
+	}
+
+	const Stop* stop_from = db_->GetStop(from);
+	const Stop* stop_to = db_->GetStop(to);
+	if (!stop_from || !stop_to) {
+		return {};
 	}
 
-	return router_.BuildRoute(stop_from, stop_to);
+	return router_.BuildRoute(stop_from->id_, stop_to->id_);
 }
 
-std::string RequestHandler::RenderMap() const {
-	return renderer_.Render();
+std::vector<StopIndex::Found> RequestHandler::FindNearestStops(geo::Coordinates center, std::optional<double> radius,
+	std::optional<size_t> count) const {
+	if (!radius) {
+		return stop_index_.FindNearest(center, count.value());
+	}
+	std::vector<StopIndex::Found> result = stop_index_.FindInRadius(center, *radius);
+	if (count && result.size() > *count) {
+		result.resize(*count);
+	}
+	return result;
+}
+
+std::string_view RequestHandler::RenderMap() const {
+	if (!map_.empty()) {
+		return map_;
+	}
+	std::call_once(render_once_, [this]() {
+		rendered_map_ = GetRenderer().Render();
+	});
+	return rendered_map_;
+}
+
+std::string RequestHandler::RenderMap(const renderer::Viewport& viewport) const {
+	return GetRenderer().Render(viewport);
+}
+
+std::optional<std::string> RequestHandler::RenderMapTile(int z, int x, int y) const {
+	const renderer::MapRender& renderer = GetRenderer();
+	if (const auto viewport = renderer.GetTile(z, x, y)) {
+		return renderer.Render(*viewport);
+	}
+	return std::nullopt;
+}
+
+const renderer::MapRender& RequestHandler::GetRenderer() const {
+	std::call_once(renderer_once_, [this]() {
+		renderer_.emplace(render_settings_, GetTransportCatalogue());
+	});
+	return *renderer_;
 }
 
 const TransportCatalogue& RequestHandler::GetTransportCatalogue() const {
-	return db_;
+	if (db_) {
+		return *db_;
+	}
+	std::call_once(catalogue_once_, [this]() {
+		catalogue_.emplace(mapped_->MakeTransportCatalogue());
+	});
+	return *catalogue_;
+}
+
+std::string_view RequestHandler::GetStopName(size_t stop_id) const {
+	if (mapped_) {
+		return mapped_->GetStopName(stop_id);
+	}
+	return db_->GetStops().at(stop_id).name_;
+}
+
+std::string_view RequestHandler::GetBusName(size_t bus_id) const {
+	if (mapped_) {
+		return mapped_->GetBusName(bus_id);
+	}
+	return db_->GetBuses().at(bus_id).name_;
 }
 
 }//namespace transport
\ No newline at end of file
@@ -1,11 +1,15 @@
 #pragma once
 
+#include <mutex>
 #include <optional>
+#include <string>
+#include <string_view>
 #include <unordered_map>
 
 #include "transport_catalogue.h"
 #include "map_renderer.h"
 #include "transport_router.h"
+#include "flat_base.h"
 
 /*
  * Здесь можно было бы разместить код обработчика запросов к базе, содержащего логику, которую не
@@ -24,19 +28,18 @@
 namespace transport {
 
     using BusPtr = Bus*;
-    struct BusStat {
-        size_t route_length;
-        double curvature;
-        size_t stop_count;
-        size_t unique_stop_count;
-    };
 
     using router::Router;
 
     class RequestHandler {
     public:
-        // MapRender понадобится в следующей части итогового проекта
-        RequestHandler(const TransportCatalogue& db, const renderer::MapRender& renderer, const router::Router& router);
+        // map — уже отрисованная SVG карты, общая для всех запросов Map. Если она пуста (база записана
+        // без карты), карта отрисуется по render_settings при первом запросе Map
+        RequestHandler(const TransportCatalogue& db, const renderer::RenderSettings& render_settings,
+            const std::string& map, const router::Router& router);
+        // Отвечает прямо по отображённой в память плоской базе: каталог из неё собирается,
+        // только если понадобится отрисовать часть карты
+        explicit RequestHandler(const flat::QueryBase& base);
 
         // Возвращает информацию о маршруте (запрос Bus)
         std::optional<BusStat> GetBusStat(const std::string_view bus_name) const;
@@ -46,17 +49,39 @@ namespace transport {
 
         std::optional<Router::RouteInfo> BuildRoute(const std::string_view from, const std::string_view to) const;
 
-        std::string RenderMap() const;
-        const TransportCatalogue& GetTransportCatalogue() const;
+        // Остановки рядом с точкой (запрос NearestStops) по возрастанию расстояния:
+        // не дальше radius метров, не больше count штук; нужно задать хотя бы одно из двух
+        std::vector<StopIndex::Found> FindNearestStops(geo::Coordinates center, std::optional<double> radius,
+            std::optional<size_t> count) const;
+
+        std::string_view RenderMap() const;
+        // Часть карты в прямоугольнике или тайле z/x/y (nullopt для тайла вне диапазона)
+        std::string RenderMap(const renderer::Viewport& viewport) const;
+        std::optional<std::string> RenderMapTile(int z, int x, int y) const;
+
+        // Имена по id из ответа маршрутизатора и индекса остановок
+        std::string_view GetStopName(size_t stop_id) const;
+        std::string_view GetBusName(size_t bus_id) const;
     private:
-        // RequestHandler использует агрегацию объектов "Транспортный Справочник" и "Визуализатор Карты"
-        const TransportCatalogue& db_;
-        const renderer::MapRender& renderer_;
+        // RequestHandler использует агрегацию объектов "Транспортный Справочник" и готовой карты.
+        // Ровно один из db_ и mapped_ не пуст
+        const TransportCatalogue* db_ = nullptr;
+        const flat::MappedBase* mapped_ = nullptr;
+        const renderer::RenderSettings& render_settings_;
+        std::string_view map_;
         const router::Router& router_;
+        const StopIndex& stop_index_;
 
-        //mutable std::unordered_map<std::string_view, std::optional<BusStat>> bus_stat_cash_;
-        //mutable std::unordered_map<std::string_view, std::optional <std::set<std::string_view>>> stop_stat_cash_;
+        // Карта, визуализатор и каталог для плоской базы создаются по первому запросу; call_once
+        // защищает от одновременного создания из нескольких потоков
+        mutable std::once_flag render_once_;
+        mutable std::string rendered_map_;
+        mutable std::once_flag renderer_once_;
+        mutable std::optional<renderer::MapRender> renderer_;
+        mutable std::once_flag catalogue_once_;
+        mutable std::optional<TransportCatalogue> catalogue_;
 
-        const std::unordered_set<BusPtr>* GetBusesByStop(const std::string_view& stop_name) const;
+        const renderer::MapRender& GetRenderer() const;
+        const TransportCatalogue& GetTransportCatalogue() const;
     };
 }//namespace transport
@@ -0,0 +1,84 @@
+#include "road_distances.h"
+
+#include <utility>
+
+using namespace std;
+
+namespace transport {
+
+	namespace {
+		constexpr size_t MIN_CAPACITY = 16;
+
+		// Финализатор MurmurHash3: соседние id остановок расходятся по всей таблице
+		uint64_t Mix(uint64_t x) {
+			x ^= x >> 33;
+			x *= 0xff51afd7ed558ccdULL;
+			x ^= x >> 33;
+			x *= 0xc4ceb9fe1a85ec53ULL;
+			x ^= x >> 33;
+			return x;
+		}
+	}
+
+	void RoadDistances::Set(size_t from, size_t to, size_t length) {
+		bool inserted = false;
+		Emplace(MakeKey(from, to), inserted).length = length;
+	}
+
+	void RoadDistances::SetIfAbsent(size_t from, size_t to, size_t length) {
+		bool inserted = false;
+		Slot& slot = Emplace(MakeKey(from, to), inserted);
+		if (inserted) {
+			slot.length = length;
+		}
+	}
+
+	size_t RoadDistances::Get(size_t from, size_t to) const {
+		if (slots_.empty()) {
+			return 0;
+		}
+		return slots_[FindSlot(MakeKey(from, to))].length;
+	}
+
+	size_t RoadDistances::Size() const {
+		return size_;
+	}
+
+	uint64_t RoadDistances::MakeKey(size_t from, size_t to) {
+		return (uint64_t{ static_cast<uint32_t>(from) } << 32) | static_cast<uint32_t>(to);
+	}
+
+	// Ёмкость — степень двойки, поэтому номер слота берётся маской
+	size_t RoadDistances::FindSlot(uint64_t key) const {
+		const size_t mask = slots_.size() - 1;
+		size_t index = static_cast<size_t>(Mix(key)) & mask;
+		while (slots_[index].key != key && slots_[index].key != EMPTY_KEY) {
+			index = (index + 1) & mask;
+		}
+		return index;
+	}
+
+	RoadDistances::Slot& RoadDistances::Emplace(uint64_t key, bool& inserted) {
+		if ((size_ + 1) * 2 > slots_.size()) {
+			Rehash(slots_.empty() ? MIN_CAPACITY : slots_.size() * 2);
+		}
+		Slot& slot = slots_[FindSlot(key)];
+		inserted = slot.key == EMPTY_KEY;
+		if (inserted) {
+			slot.key = key;
+			++size_;
+		}
+		return slot;
+	}
+
+	void RoadDistances::Rehash(size_t capacity) {
+		std::vector<Slot> old_slots(capacity);
+		swap(slots_, old_slots);
+		for (const Slot& slot : old_slots) {
+			if (slot.key != EMPTY_KEY) {
+				slots_[FindSlot(slot.key)] = slot;
+			}
+		}
+	}
+
+} // namespace transport
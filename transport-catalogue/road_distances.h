@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace transport {
+
+	// Дорожные расстояния между остановками по паре id. Открытая адресация с линейным пробированием:
+	// ключ (from << 32 | to) перемешивается 64-битной функцией, таблица заполнена не больше чем наполовину.
+	// Незаданное расстояние равно 0
+	class RoadDistances {
+	public:
+		// Задаёт расстояние from -> to, заменяя прежнее
+		void Set(size_t from, size_t to, size_t length);
+		// Задаёт расстояние from -> to, только если оно ещё не задано
+		void SetIfAbsent(size_t from, size_t to, size_t length);
+		size_t Get(size_t from, size_t to) const;
+		size_t Size() const;
+
+		// Вызывает func(from, to, length) для всех заданных расстояний в порядке слотов таблицы
+		template <typename Func>
+		void ForEach(Func func) const;
+
+	private:
+		static constexpr uint64_t EMPTY_KEY = UINT64_MAX;
+
+		struct Slot {
+			uint64_t key = EMPTY_KEY;
+			size_t length = 0;
+		};
+
+		std::vector<Slot> slots_;
+		size_t size_ = 0;
+
+		static uint64_t MakeKey(size_t from, size_t to);
+		// Слот с ключом key или пустой слот, в который его следует вставить
+		size_t FindSlot(uint64_t key) const;
+		// Слот для ключа key; inserted = true, если ключа не было
+		Slot& Emplace(uint64_t key, bool& inserted);
+		void Rehash(size_t capacity);
+	};
+
+	template <typename Func>
+	void RoadDistances::ForEach(Func func) const {
+		for (const Slot& slot : slots_) {
+			if (slot.key != EMPTY_KEY) {
+				func(static_cast<size_t>(slot.key >> 32), static_cast<size_t>(slot.key & UINT32_MAX), slot.length);
+			}
+		}
+	}
+
+} // namespace transport
@@ -6,6 +6,7 @@
 #include <cassert>
 #include <cstdint>
 #include <iterator>
+#include <limits>
 #include <optional>
 #include <stdexcept>
 #include <unordered_map>
@@ -15,103 +16,165 @@
 namespace graph {
 
     template <typename Weight>
-    class Router {
-    private:
-        using Graph = DirectedWeightedGraph<Weight>;
+    struct RouteInfo {
+        Weight weight;
+        std::vector<EdgeId> edges;
+    };
 
+    template <typename Weight, typename Graph = DirectedWeightedGraph<Weight>>
+    class Router {
     public:
+        // Плоские таблицы V x V кратчайших маршрутов, по строке на вершину-источник.
+        // prev_edges: 0 — ребра нет (маршрут из вершины в себя или недостижимая вершина), иначе id последнего ребра + 1.
+        // weights: вес маршрута; для недостижимой вершины не используется.
+        // Таблицы могут ссылаться на отображённую в память базу
+        struct RoutesTable {
+            ranges::Storage<std::uint32_t> prev_edges;
+            ranges::Storage<Weight> weights;
+        };
+
         explicit Router(const Graph& graph);
+        // Берёт предрасчитанные маршруты без повторного прохода Флойда-Уоршелла. Проверяются только
+        // размеры таблиц, id рёбер маршрута — при его восстановлении
+        Router(const Graph& graph, RoutesTable routes);
 
-        struct RouteInfo {
-            Weight weight;
-            std::vector<EdgeId> edges;
-        };
+        using RouteInfo = graph::RouteInfo<Weight>;
 
         std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
 
+        const RoutesTable& GetRoutesTable() const;
+
     private:
-        struct RouteInternalData {
-            Weight weight;
-            std::optional<EdgeId> prev_edge;
+        static constexpr Weight ZERO_WEIGHT{};
+        const Graph& graph_;
+        size_t vertex_count_;
+        RoutesTable routes_;
+
+        // Таблицы во время прохода Флойда-Уоршелла, до передачи в routes_
+        struct MutableRoutesTable {
+            std::vector<std::uint32_t> prev_edges;
+            std::vector<Weight> weights;
         };
-        using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
-
-        void InitializeRoutesInternalData(const Graph& graph) {
-            const size_t vertex_count = graph.GetVertexCount();
-            for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-                routes_internal_data_[vertex][vertex] = RouteInternalData{ ZERO_WEIGHT, std::nullopt };
-                for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
-                    const auto& edge = graph.GetEdge(edge_id);
+
+        size_t GetIndex(VertexId from, VertexId to) const {
+            return from * vertex_count_ + to;
+        }
+
+        bool HasRoute(VertexId from, VertexId to) const {
+            return from == to || routes_.prev_edges[GetIndex(from, to)] != 0;
+        }
+
+        bool HasRoute(const MutableRoutesTable& routes, VertexId from, VertexId to) const {
+            return from == to || routes.prev_edges[GetIndex(from, to)] != 0;
+        }
+
+        void InitializeRoutes(MutableRoutesTable& routes) const {
+            if (graph_.GetEdgeCount() >= std::numeric_limits<std::uint32_t>::max()) {
+                throw std::length_error("Too many edges for routes table");
+            }
+            for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+                for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+                    if (edge_id >= graph_.GetEdgeCount()) {
+                        throw std::invalid_argument("Graph edge id out of range");
+                    }
+                    const auto& edge = graph_.GetEdge(edge_id);
+                    if (edge.to >= vertex_count_) {
+                        throw std::invalid_argument("Graph edge vertex out of range");
+                    }
                     if (edge.weight < ZERO_WEIGHT) {
                         throw std::domain_error("Edges' weights should be non-negative");
                     }
-                    auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-                    if (!route_internal_data || route_internal_data->weight > edge.weight) {
-                        route_internal_data = RouteInternalData{ edge.weight, edge_id };
+                    const size_t index = GetIndex(vertex, edge.to);
+                    if (!HasRoute(routes, vertex, edge.to) || routes.weights[index] > edge.weight) {
+                        routes.weights[index] = edge.weight;
+                        routes.prev_edges[index] = static_cast<std::uint32_t>(edge_id + 1);
                     }
                 }
             }
         }
 
-        void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
-            const RouteInternalData& route_to) {
-            auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
-            const Weight candidate_weight = route_from.weight + route_to.weight;
-            if (!route_relaxing || candidate_weight < route_relaxing->weight) {
-                route_relaxing = { candidate_weight,
-                                  route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge };
-            }
-        }
-
-        void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
-            for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-                if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
-                    for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-                        if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-                            RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
-                        }
+        void RelaxRoutesThroughVertex(MutableRoutesTable& routes, VertexId vertex_through) const {
+            for (VertexId vertex_from = 0; vertex_from < vertex_count_; ++vertex_from) {
+                if (!HasRoute(routes, vertex_from, vertex_through)) {
+                    continue;
+                }
+                const Weight weight_from = routes.weights[GetIndex(vertex_from, vertex_through)];
+                const std::uint32_t prev_edge_from = routes.prev_edges[GetIndex(vertex_from, vertex_through)];
+                for (VertexId vertex_to = 0; vertex_to < vertex_count_; ++vertex_to) {
+                    if (!HasRoute(routes, vertex_through, vertex_to)) {
+                        continue;
+                    }
+                    const size_t index_to = GetIndex(vertex_through, vertex_to);
+                    const size_t index = GetIndex(vertex_from, vertex_to);
+                    const Weight candidate_weight = weight_from + routes.weights[index_to];
+                    if (!HasRoute(routes, vertex_from, vertex_to) || candidate_weight < routes.weights[index]) {
+                        routes.weights[index] = candidate_weight;
+                        routes.prev_edges[index] = routes.prev_edges[index_to] ? routes.prev_edges[index_to] : prev_edge_from;
                     }
                 }
             }
         }
-
-        static constexpr Weight ZERO_WEIGHT{};
-        const Graph& graph_;
-        RoutesInternalData routes_internal_data_;
     };
 
-    template <typename Weight>
-    Router<Weight>::Router(const Graph& graph)
+    template <typename Weight, typename Graph>
+    Router<Weight, Graph>::Router(const Graph& graph)
         : graph_(graph)
-        , routes_internal_data_(graph.GetVertexCount(),
-            std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
+        , vertex_count_(graph.GetVertexCount())
     {
-        InitializeRoutesInternalData(graph);
+        MutableRoutesTable routes{
+            std::vector<std::uint32_t>(vertex_count_ * vertex_count_, 0),
+            std::vector<Weight>(vertex_count_ * vertex_count_, ZERO_WEIGHT)
+        };
+        InitializeRoutes(routes);
+        for (VertexId vertex_through = 0; vertex_through < vertex_count_; ++vertex_through) {
+            RelaxRoutesThroughVertex(routes, vertex_through);
+        }
+        routes_ = RoutesTable{ std::move(routes.prev_edges), std::move(routes.weights) };
+    }
 
-        const size_t vertex_count = graph.GetVertexCount();
-        for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-            RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+    template <typename Weight, typename Graph>
+    Router<Weight, Graph>::Router(const Graph& graph, RoutesTable routes)
+        : graph_(graph)
+        , vertex_count_(graph.GetVertexCount())
+        , routes_(std::move(routes))
+    {
+        if (routes_.prev_edges.size() != vertex_count_ * vertex_count_
+            || routes_.weights.size() != routes_.prev_edges.size()) {
+            throw std::invalid_argument("Routes table size mismatch");
         }
     }
 
-    template <typename Weight>
-    std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
+    template <typename Weight, typename Graph>
+    const typename Router<Weight, Graph>::RoutesTable& Router<Weight, Graph>::GetRoutesTable() const {
+        return routes_;
+    }
+
+    // Таблица могла прийти из базы, поэтому id рёбер и длина пути проверяются
+    template <typename Weight, typename Graph>
+    std::optional<typename Router<Weight, Graph>::RouteInfo> Router<Weight, Graph>::BuildRoute(VertexId from,
         VertexId to) const {
-        const auto& route_internal_data = routes_internal_data_.at(from).at(to);
-        if (!route_internal_data) {
+        if (from >= vertex_count_ || to >= vertex_count_) {
+            throw std::out_of_range("BuildRoute: vertex id out of range");
+        }
+        if (!HasRoute(from, to)) {
             return std::nullopt;
         }
-        const Weight weight = route_internal_data->weight;
         std::vector<EdgeId> edges;
-        for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
-            edge_id;
-            edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
-        {
-            edges.push_back(*edge_id);
+        for (std::uint32_t prev_edge = routes_.prev_edges[GetIndex(from, to)]; prev_edge;) {
+            const EdgeId edge_id = prev_edge - 1;
+            if (edge_id >= graph_.GetEdgeCount() || edges.size() >= vertex_count_) {
+                throw std::invalid_argument("Routes table is inconsistent with graph");
+            }
+            const VertexId edge_from = graph_.GetEdge(edge_id).from;
+            if (edge_from >= vertex_count_) {
+                throw std::invalid_argument("Routes table is inconsistent with graph");
+            }
+            edges.push_back(edge_id);
+            prev_edge = routes_.prev_edges[GetIndex(from, edge_from)];
         }
         std::reverse(edges.begin(), edges.end());
 
-        return RouteInfo{ weight, std::move(edges) };
+        return RouteInfo{ routes_.weights[GetIndex(from, to)], std::move(edges) };
     }
 
 }  // namespace graph
@@ -1,14 +1,44 @@
 #include "serialization.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <iostream>
+#include <stdexcept>
 
 namespace transport {
 namespace serialize {
+
+static constexpr uint32_t TRANSPORT_CATALOGUE_FORMAT_VERSION = 1;
+
+std::vector<std::pair<uint32_t, size_t>> DeserializeRoadDistance(const Stop& stop, uint32_t format_version) {
+	std::vector<std::pair<uint32_t, size_t>> ret;
+
+	if (format_version == 0) {
+		ret.reserve(stop.road_distance_size());
+		for (uint32_t dis : stop.road_distance()) {
+			ret.push_back({ dis & 0x7FF, dis >> 11 });
+		}
+		return ret;
+	}
+
+	if (stop.road_distance_stop_delta_size() != stop.road_distance_length_size()) {
+		throw std::logic_error("Data base is broken: road distance arrays mismatch");
+	}
+	ret.reserve(stop.road_distance_stop_delta_size());
+	uint32_t other_id = 0;
+	for (int i = 0; i < stop.road_distance_stop_delta_size(); ++i) {
+		other_id += stop.road_distance_stop_delta(i);
+		ret.push_back({ other_id, stop.road_distance_length(i) });
+	}
+	return ret;
+}
 	
 void DeserializeTransportCatalogue(transport::TransportCatalogue& transport_catalogue, const TransportCatalogue& base) {
 	
-	std::unordered_map<std::string, std::unordered_map<std::string, size_t>> length_from_to;
+	if (base.format_version() > TRANSPORT_CATALOGUE_FORMAT_VERSION) {
+		throw std::logic_error("Data base format version is not supported");
+	}
+
 	for(int i = 0; i < base.stop_size(); ++i) {
 		const Stop& stop = base.stop(i);
 		transport_catalogue.AddStop(
@@ -19,32 +49,74 @@ void DeserializeTransportCatalogue(transport::TransportCatalogue& transport_cata
 			}
 		);
 		
-		for(int length_ind = 0; length_ind < stop.road_distance_size(); ++length_ind) {
-			uint32_t dis = stop.road_distance(length_ind);
-			int other_id = dis & 0x7FF;
-			const Stop& other = base.stop(other_id);
-			length_from_to[stop.name()][other.name()] = dis >> 11;
+	}
+
+	for(int i = 0; i < base.stop_size(); ++i) {
+		for (auto [other_id, length] : DeserializeRoadDistance(base.stop(i), base.format_version())) {
+			if (other_id >= static_cast<uint32_t>(base.stop_size())) {
+				throw std::logic_error("Data base is broken: road distance to unknown stop");
+			}
+			transport_catalogue.SetLengthBetweenStops(static_cast<size_t>(i), other_id, length);
 		}
 	}
 	
-	transport_catalogue.SetLengthBetweenStops(length_from_to);
-	
+	std::vector<size_t> stop_ids;
+	std::vector<transport::BusStat> bus_stats;
+	bool has_bus_stats = true;
 	for(int bus_id = 0; bus_id < base.bus_size(); ++bus_id) {
 		const Bus& bus = base.bus(bus_id);
 		
-		std::vector<std::string> stop_names;
-		stop_names.reserve(bus.stop_id_size());
-		
-		for(int stop_index = 0; stop_index < bus.stop_id_size(); ++stop_index) {
-			auto stop_id = bus.stop_id(stop_index);
-			const Stop& stop = base.stop(stop_id);
-			stop_names.push_back(stop.name());
+		stop_ids.assign(bus.stop_id().begin(), bus.stop_id().end());
+		transport_catalogue.AddBusWithStopIds(bus.name(), bus.is_roundtrip(), stop_ids);
+
+		has_bus_stats = has_bus_stats && bus.has_stat();
+		if (has_bus_stats) {
+			bus_stats.push_back(DeserializeBusStat(bus.stat()));
 		}
+	}
 
-		transport_catalogue.AddBus(bus.name(), bus.is_roundtrip(), stop_names);
+	if (has_bus_stats) {
+		transport_catalogue.SetBusStats(std::move(bus_stats));
+	}
+	else {
+		transport_catalogue.ComputeBusStats();
+	}
+
+	if (base.has_stop_index()) {
+		const StopIndex& index = base.stop_index();
+		transport::StopIndex::Grid grid;
+		grid.min = { index.min_latitude(), index.min_longitude() };
+		grid.cell_lat = index.cell_latitude();
+		grid.cell_lng = index.cell_longitude();
+		grid.rows = index.rows();
+		grid.columns = index.columns();
+		transport_catalogue.SetStopIndex(grid,
+			{ index.cell_offset().begin(), index.cell_offset().end() },
+			{ index.stop_id().begin(), index.stop_id().end() });
+	}
+	else {
+		transport_catalogue.BuildStopIndex();
 	}
 }
 
+BusStat SerializeBusStat(const transport::BusStat& stat) {
+	BusStat ret;
+	ret.set_route_length(stat.route_length);
+	ret.set_curvature(stat.curvature);
+	ret.set_stop_count(static_cast<uint32_t>(stat.stop_count));
+	ret.set_unique_stop_count(static_cast<uint32_t>(stat.unique_stop_count));
+	return ret;
+}
+
+transport::BusStat DeserializeBusStat(const BusStat& stat) {
+	return {
+		static_cast<size_t>(stat.route_length()),
+		stat.curvature(),
+		stat.stop_count(),
+		stat.unique_stop_count()
+	};
+}
+
 transport::TransportCatalogue DeserializeTransportCatalogue(const TransportCatalogue& input) {
 	transport::TransportCatalogue transport_catalogue;
 	DeserializeTransportCatalogue(transport_catalogue, input);
@@ -59,39 +131,33 @@ Stop SerializeStop(const transport::Stop stop) {
 	return ret;
 }
 
-std::unordered_map<const transport::Stop*, std::unordered_map<const transport::Stop*, size_t>> 
-GetUniqueMapMap(const transport::TransportCatalogue& transport_catalogue) {
-	const auto& length_map = transport_catalogue.GetLengthMap();
-
-	std::unordered_map<const transport::Stop*, std::unordered_map<const transport::Stop*, size_t>> uniq_len;
-	for (const auto& [from_to, len] : length_map) {
-		const transport::Stop* from = from_to.first;
-		const transport::Stop* to = from_to.second;
-		auto it_to = uniq_len.find(to);
-		if (it_to != uniq_len.end()) {
-			auto it_from = it_to->second.find(from);
-			if (it_from != it_to->second.end()) {
-				if (it_from->second == len) {
-					continue;
-				}
-			}
+// Дорожные расстояния по id остановки отправления. Пара встречных направлений с одинаковой длиной
+// сохраняется один раз, от меньшего id: обратное направление восстановит SetLengthBetweenStops
+std::vector<std::vector<std::pair<uint32_t, uint32_t>>> GetUniqueRoadDistances(const transport::TransportCatalogue& transport_catalogue) {
+	const transport::RoadDistances& road_distances = transport_catalogue.GetRoadDistances();
+	std::vector<std::vector<std::pair<uint32_t, uint32_t>>> to_lengths(transport_catalogue.GetStops().size());
+	road_distances.ForEach([&road_distances, &to_lengths](size_t from, size_t to, size_t length) {
+		if (from > to && road_distances.Get(to, from) == length) {
+			return;
 		}
-		uniq_len[from][to] = len;
-	}
-	return uniq_len;
+		to_lengths[from].push_back({ static_cast<uint32_t>(to), static_cast<uint32_t>(length) });
+	});
+	return to_lengths;
 }
 
 void AddRoadDistance(TransportCatalogue& output_tc, const transport::TransportCatalogue& transport_catalogue) {
-	std::unordered_map<const transport::Stop*, std::unordered_map<const transport::Stop*, size_t>> uniq_len
-		= GetUniqueMapMap(transport_catalogue);
-
-	for (const auto& [pfrom, umap] : uniq_len) {
-		size_t from = transport_catalogue.GetStopIndex(pfrom->name_);
-
-		for (const auto& [pto, len] : umap) {
-			size_t to = transport_catalogue.GetStopIndex(pto->name_);
-			uint32_t distance = (static_cast<uint32_t>(to) & 0x7FF) | (static_cast<uint32_t>(len) << 11);
-			output_tc.mutable_stop(static_cast<int>(from))->add_road_distance(distance);
+	std::vector<std::vector<std::pair<uint32_t, uint32_t>>> uniq_len = GetUniqueRoadDistances(transport_catalogue);
+
+	for (size_t from = 0; from < uniq_len.size(); ++from) {
+		std::vector<std::pair<uint32_t, uint32_t>>& to_lengths = uniq_len[from];
+		std::sort(to_lengths.begin(), to_lengths.end());
+
+		Stop* output_stop = output_tc.mutable_stop(static_cast<int>(from));
+		uint32_t prev_to = 0;
+		for (auto [to, len] : to_lengths) {
+			output_stop->add_road_distance_stop_delta(to - prev_to);
+			output_stop->add_road_distance_length(len);
+			prev_to = to;
 		}
 	}
 }
@@ -109,20 +175,36 @@ void AddBuses(TransportCatalogue& output_tc, const transport::TransportCatalogue
 		proto_bus.set_name(bus.name_);
 		proto_bus.set_is_roundtrip(bus.circular_);
 
-		for (const transport::Stop* stop : bus.stops_) {
-			auto stop_id = transport_catalogue.GetStopIndex(stop->name_);
+		for (size_t stop_id : transport_catalogue.GetBusStopIds(&bus)) {
 			proto_bus.add_stop_id(static_cast<uint32_t>(stop_id));
 		}
+		*proto_bus.mutable_stat() = SerializeBusStat(transport_catalogue.GetBusStat(&bus));
 		*output_tc.add_bus() = std::move(proto_bus);
 	}
 }
 
+StopIndex SerializeStopIndex(const transport::StopIndex& stop_index) {
+	StopIndex ret;
+	const transport::StopIndex::Grid& grid = stop_index.GetGrid();
+	ret.set_min_latitude(grid.min.lat);
+	ret.set_min_longitude(grid.min.lng);
+	ret.set_cell_latitude(grid.cell_lat);
+	ret.set_cell_longitude(grid.cell_lng);
+	ret.set_rows(grid.rows);
+	ret.set_columns(grid.columns);
+	*ret.mutable_cell_offset() = { stop_index.GetCellOffsets().begin(), stop_index.GetCellOffsets().end() };
+	*ret.mutable_stop_id() = { stop_index.GetStopIds().begin(), stop_index.GetStopIds().end() };
+	return ret;
+}
+
 TransportCatalogue SerializeTransportCatalogue(const transport::TransportCatalogue& transport_catalogue) {
 	TransportCatalogue ret_transport_catalogue;
+	ret_transport_catalogue.set_format_version(TRANSPORT_CATALOGUE_FORMAT_VERSION);
 	
 	AddStops(ret_transport_catalogue, transport_catalogue);
 	AddRoadDistance(ret_transport_catalogue, transport_catalogue);
 	AddBuses(ret_transport_catalogue, transport_catalogue);
+	*ret_transport_catalogue.mutable_stop_index() = SerializeStopIndex(transport_catalogue.GetStopIndex());
 	
 	return ret_transport_catalogue;
 }
@@ -131,12 +213,15 @@ void SaveTransportCatalogueTo(
 	const transport::TransportCatalogue& transport_catalogue, 
 	const renderer::RenderSettings& render_settings, 
 	const router::Router& router,
-	std::ostream& output) {
+	const std::string& map,
+	std::ostream& output,
+	const SerializationSettings& settings) {
 	transport::serialize::Base save;
 	
 	*save.mutable_transport_catalogue() = SerializeTransportCatalogue(transport_catalogue);
 	*save.mutable_render_settings() = SerializeRenderSettings(render_settings);
-	*save.mutable_router() = SerializeRouter(router);
+	*save.mutable_router() = SerializeRouter(router, settings.store_routes);
+	save.set_map(map);
 
 	save.SerializeToOstream(&output);
 }
@@ -211,7 +296,7 @@ Edge SerializeEdge(const graph::Edge<double>& edge) {
 	return ret;
 }
 
-Graph SerializeGraph(const graph::DirectedWeightedGraph<double>& graph) {
+Graph SerializeGraph(const router::DirectedGraph& graph) {
 	Graph ret;
 
 	ret.set_vertex_count(static_cast<uint32_t>(graph.GetVertexCount()));
@@ -229,18 +314,30 @@ graph::Edge<double> DeserializeEdge(const Edge& edge) {
 	return ret;
 }
 
-graph::DirectedWeightedGraph<double> DeserializeGraph(const Graph& graph) {
-	graph::DirectedWeightedGraph<double> ret{graph.vertex_count()};
+router::DirectedGraph DeserializeGraph(const Graph& graph) {
+	std::vector<graph::Edge<double>> edges;
+	edges.reserve(graph.edge_size());
 	for (int i = 0; i < graph.edge_size(); ++i) {
-		ret.AddEdge(DeserializeEdge(graph.edge(i)));
+		edges.push_back(DeserializeEdge(graph.edge(i)));
 	}
-	return ret;
+	return router::DirectedGraph{ graph.vertex_count(), std::move(edges) };
 }
 
 RouterSettings SerializeRouterSettings(const router::RouterSettings& router_settings) {
 	RouterSettings ret;
 	ret.set_bus_wait_time_min(router_settings.bus_wait_time);
 	ret.set_bus_velocity_km_per_h(router_settings.bus_velocity);
+	switch (router_settings.engine) {
+	case router::RouterEngine::ALL_PAIRS:
+		ret.set_engine(ALL_PAIRS);
+		break;
+	case router::RouterEngine::DIJKSTRA:
+		ret.set_engine(DIJKSTRA);
+		break;
+	case router::RouterEngine::CONTRACTION_HIERARCHY:
+		ret.set_engine(CONTRACTION_HIERARCHY);
+		break;
+	}
 	return ret;
 }
 
@@ -276,9 +373,43 @@ RouterGraph SerializeRouterGraph(const router::Graph& graph) {
 	return ret;
 }
 
-Router SerializeRouter(const router::Router& router) {
+RoutesTable SerializeRoutesTable(const router::Router::RoutesTable& routes) {
+	RoutesTable ret;
+	ret.mutable_prev_edge()->Add(routes.prev_edges.begin(), routes.prev_edges.end());
+	ret.mutable_weight()->Add(routes.weights.begin(), routes.weights.end());
+	return ret;
+}
+
+ContractionHierarchy SerializeContractionHierarchy(const router::Router::ContractionHierarchy& hierarchy) {
+	ContractionHierarchy ret;
+	ret.mutable_rank()->Reserve(static_cast<int>(hierarchy.ranks.size()));
+	for (size_t rank : hierarchy.ranks) {
+		ret.add_rank(static_cast<uint32_t>(rank));
+	}
+	ret.mutable_shortcut()->Reserve(static_cast<int>(hierarchy.shortcuts.size()));
+	for (const auto& shortcut : hierarchy.shortcuts) {
+		Shortcut* proto_shortcut = ret.add_shortcut();
+		proto_shortcut->set_from_vertex(static_cast<uint32_t>(shortcut.from));
+		proto_shortcut->set_to_vertex(static_cast<uint32_t>(shortcut.to));
+		proto_shortcut->set_weight(shortcut.weight);
+		proto_shortcut->set_first_edge(static_cast<uint32_t>(shortcut.first));
+		proto_shortcut->set_second_edge(static_cast<uint32_t>(shortcut.second));
+	}
+	return ret;
+}
+
+Router SerializeRouter(const router::Router& router, bool store_routes) {
 	Router ret;
 	*ret.mutable_graph() = SerializeRouterGraph(router.GetGraph());
+	*ret.mutable_settings() = SerializeRouterSettings(router.GetSettings());
+	if (store_routes) {
+		if (auto routes = router.GetRoutesTable()) {
+			*ret.mutable_routes() = SerializeRoutesTable(*routes);
+		}
+	}
+	if (const auto* hierarchy = router.GetContractionHierarchy()) {
+		*ret.mutable_hierarchy() = SerializeContractionHierarchy(*hierarchy);
+	}
 	return ret;
 }
 
@@ -286,6 +417,17 @@ router::RouterSettings DeserializeRouterSettings(const RouterSettings& router_se
 	router::RouterSettings ret;
 	ret.bus_wait_time = router_settings.bus_wait_time_min();
 	ret.bus_velocity = router_settings.bus_velocity_km_per_h();
+	switch (router_settings.engine()) {
+	case DIJKSTRA:
+		ret.engine = router::RouterEngine::DIJKSTRA;
+		break;
+	case CONTRACTION_HIERARCHY:
+		ret.engine = router::RouterEngine::CONTRACTION_HIERARCHY;
+		break;
+	default:
+		ret.engine = router::RouterEngine::ALL_PAIRS;
+		break;
+	}
 	return ret;
 }
 
@@ -313,18 +455,58 @@ router::EdgeInfo DeserializeEdgeInfo(const EdgeInfo& info) {
 }
 
 router::Graph DeserializeRouterGraph(const RouterGraph& graph) {
-	router::Graph ret;
-	ret.directed_weighted_graph = DeserializeGraph(graph.graph());
-
+	std::vector<router::EdgeInfo> edges;
+	edges.reserve(graph.edge_info_size());
 	for (int i = 0; i < graph.edge_info_size(); ++i) {
-		ret.edges.push_back(DeserializeEdgeInfo(graph.edge_info(i)));
+		edges.push_back(DeserializeEdgeInfo(graph.edge_info(i)));
 	}
-	return ret;
+	return { DeserializeGraph(graph.graph()), std::move(edges) };
+}
+
+router::Router::RoutesTable DeserializeRoutesTable(const RoutesTable& routes) {
+	return {
+		std::vector<uint32_t>(routes.prev_edge().begin(), routes.prev_edge().end()),
+		std::vector<router::Time>(routes.weight().begin(), routes.weight().end())
+	};
+}
+
+router::Router::ContractionHierarchy DeserializeContractionHierarchy(const ContractionHierarchy& hierarchy) {
+	std::vector<graph::ContractionHierarchyRouter<router::Time, router::DirectedGraph>::Shortcut> shortcuts;
+	shortcuts.reserve(hierarchy.shortcut_size());
+	for (const Shortcut& shortcut : hierarchy.shortcut()) {
+		shortcuts.push_back({
+			shortcut.from_vertex(),
+			shortcut.to_vertex(),
+			shortcut.weight(),
+			shortcut.first_edge(),
+			shortcut.second_edge()
+		});
+	}
+	return { std::vector<size_t>(hierarchy.rank().begin(), hierarchy.rank().end()), std::move(shortcuts) };
 }
 
 router::Router DeserializeRouter(const Router& router) {
+	if (router.has_hierarchy()) {
+		return router::Router(
+			DeserializeRouterGraph(router.graph()),
+			DeserializeRouterSettings(router.settings()),
+			DeserializeContractionHierarchy(router.hierarchy()));
+	}
+	if (HasStoredRoutes(router)) {
+		return router::Router(
+			DeserializeRouterGraph(router.graph()),
+			DeserializeRouterSettings(router.settings()),
+			DeserializeRoutesTable(router.routes()));
+	}
 	return router::Router(
-		DeserializeRouterGraph(router.graph()));
+		DeserializeRouterGraph(router.graph()),
+		DeserializeRouterSettings(router.settings()));
+}
+
+bool HasStoredRoutes(const Router& router) {
+	// Таблица без весов записана старой версией: маршруты считаются заново
+	return !router.has_hierarchy() && router.has_routes()
+		&& router.routes().weight_size() == router.routes().prev_edge_size();
 }
 
 }
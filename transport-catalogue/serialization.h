@@ -9,7 +9,16 @@
 namespace transport {
 namespace serialize {
 	
-	
+enum class BaseFormat {
+	PROTOBUF,
+	FLAT // см. flat_base.h
+};
+
+struct SerializationSettings {
+	// Сохранять предрасчитанные маршруты, чтобы process_requests не считал их заново
+	bool store_routes = false;
+	BaseFormat format = BaseFormat::PROTOBUF;
+};
 	
 transport::TransportCatalogue DeserializeTransportCatalogue(const TransportCatalogue& input);
 TransportCatalogue SerializeTransportCatalogue(const transport::TransportCatalogue& input);
@@ -18,16 +27,23 @@ void SaveTransportCatalogueTo(
 	const transport::TransportCatalogue& transport_catalogue,
 	const renderer::RenderSettings& render_settings,
 	const router::Router& router,
-	std::ostream& output);
+	const std::string& map,
+	std::ostream& output,
+	const SerializationSettings& settings = {});
+
+BusStat SerializeBusStat(const transport::BusStat& stat);
+transport::BusStat DeserializeBusStat(const BusStat& stat);
 
 renderer::RenderSettings DeserializeRenderSettings(const RenderSettings& input);
 RenderSettings SerializeRenderSettings(const renderer::RenderSettings& input);
 
-Graph SerializeGraph(const graph::DirectedWeightedGraph<double>& graph);
-graph::DirectedWeightedGraph<double> DeserializeGraph(const Graph& graph);
+Graph SerializeGraph(const router::DirectedGraph& graph);
+router::DirectedGraph DeserializeGraph(const Graph& graph);
 
-Router SerializeRouter(const router::Router& router);
+Router SerializeRouter(const router::Router& router, bool store_routes = false);
 router::Router DeserializeRouter(const Router& router);
+// Есть ли в базе таблица маршрутов, которую DeserializeRouter загрузит, а не посчитает заново
+bool HasStoredRoutes(const Router& router);
 
 }
 }
\ No newline at end of file
@@ -0,0 +1,315 @@
+#include "server.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define TRANSPORT_SERVER_SOCKETS
+#endif
+
+namespace transport {
+namespace server {
+
+using namespace std;
+
+Snapshot::Snapshot(json::StatBase loaded_base, size_t thread_count)
+	: base(std::move(loaded_base))
+	, reader(base, thread_count) {
+}
+
+SnapshotHolder::SnapshotHolder(std::function<json::StatBase()> load_base, size_t thread_count)
+	: load_base_(std::move(load_base))
+	, thread_count_(thread_count)
+	, snapshot_(MakeSnapshot()) {
+	reload_thread_ = thread([this]() {
+		RunReloads();
+	});
+}
+
+SnapshotHolder::~SnapshotHolder() {
+	{
+		lock_guard lock(mutex_);
+		stopping_ = true;
+	}
+	queue_cv_.notify_one();
+	reload_thread_.join();
+}
+
+shared_ptr<const Snapshot> SnapshotHolder::Get() const {
+	return atomic_load(&snapshot_);
+}
+
+future<void> SnapshotHolder::RequestReload() {
+	promise<void> request;
+	future<void> result = request.get_future();
+	{
+		lock_guard lock(mutex_);
+		reload_requests_.push_back(std::move(request));
+	}
+	queue_cv_.notify_one();
+	return result;
+}
+
+// Снимок удаляется не там, где его отпустили, а в потоке перезагрузки
+shared_ptr<const Snapshot> SnapshotHolder::MakeSnapshot() {
+	return shared_ptr<const Snapshot>(new Snapshot(load_base_(), thread_count_), [this](const Snapshot* snapshot) {
+		Retire(snapshot);
+	});
+}
+
+void SnapshotHolder::Retire(const Snapshot* snapshot) {
+	{
+		lock_guard lock(mutex_);
+		if (!stopping_) {
+			retired_.push_back(snapshot);
+			queue_cv_.notify_one();
+			return;
+		}
+	}
+	// Поток перезагрузки уже остановлен: последний снимок освобождается деструктором SnapshotHolder
+	delete snapshot;
+}
+
+void SnapshotHolder::RunReloads() {
+	unique_lock lock(mutex_);
+	for (;;) {
+		queue_cv_.wait(lock, [this]() {
+			return stopping_ || !reload_requests_.empty() || !retired_.empty();
+		});
+		vector<const Snapshot*> retired = std::move(retired_);
+		retired_.clear();
+		vector<promise<void>> requests = std::move(reload_requests_);
+		reload_requests_.clear();
+		const bool stopping = stopping_;
+		lock.unlock();
+
+		for (const Snapshot* snapshot : retired) {
+			delete snapshot;
+		}
+		// Необработанные запросы при остановке получат broken_promise
+		if (stopping) {
+			return;
+		}
+		if (!requests.empty()) {
+			try {
+				shared_ptr<const Snapshot> old = atomic_exchange(&snapshot_, MakeSnapshot());
+				for (promise<void>& request : requests) {
+					request.set_value();
+				}
+			}
+			catch (...) {
+				for (promise<void>& request : requests) {
+					request.set_exception(current_exception());
+				}
+			}
+		}
+		lock.lock();
+	}
+}
+
+namespace {
+
+	string AnswerLine(SnapshotHolder& holder, string_view line) {
+		ostringstream output;
+		try {
+			istringstream input{ string(line) };
+			const ::json::Document document = ::json::Load(input);
+			const ::json::Node& root = document.GetRoot();
+			if (!root.IsDict()) {
+				holder.Get()->reader(root, output);
+			}
+			else if (const auto it = root.AsDict().find("stat_requests"s); it != root.AsDict().end()) {
+				holder.Get()->reader(it->second, output);
+			}
+			else if (const auto control = root.AsDict().find("control"s); control != root.AsDict().end()) {
+				if (control->second != ::json::Node{ "reload"s }) {
+					throw logic_error("Unknown control request"s);
+				}
+				holder.RequestReload().get();
+				::json::Writer{ output }.StartDict().Key("reloaded").Value(true).EndDict();
+			}
+			else {
+				throw logic_error("stat_requests not found"s);
+			}
+		}
+		catch (const exception& e) {
+			output.str({});
+			::json::Writer{ output }.StartDict().Key("error").Value(e.what()).EndDict();
+		}
+		output << '\n';
+		return output.str();
+	}
+
+#ifdef TRANSPORT_SERVER_SOCKETS
+
+	runtime_error SocketError(const string& what) {
+		return runtime_error(what + ": "s + strerror(errno));
+	}
+
+	int Listen(const ServerSettings& settings) {
+		const int fd = ::socket(settings.port ? AF_INET : AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0) {
+			throw SocketError("Can't create socket"s);
+		}
+
+		int bound = -1;
+		if (settings.port) {
+			const int reuse = 1;
+			::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+			sockaddr_in address{};
+			address.sin_family = AF_INET;
+			address.sin_port = htons(*settings.port);
+			address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			bound = ::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+		}
+		else {
+			sockaddr_un address{};
+			address.sun_family = AF_UNIX;
+			if (settings.socket_path.size() >= sizeof(address.sun_path)) {
+				::close(fd);
+				throw runtime_error("Socket path is too long: "s + settings.socket_path);
+			}
+			memcpy(address.sun_path, settings.socket_path.c_str(), settings.socket_path.size() + 1);
+			// Файл сокета мог остаться от прошлого запуска
+			::unlink(settings.socket_path.c_str());
+			bound = ::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+		}
+
+		if (bound != 0 || ::listen(fd, SOMAXCONN) != 0) {
+			const runtime_error error = SocketError("Can't listen on socket"s);
+			::close(fd);
+			throw error;
+		}
+		return fd;
+	}
+
+	bool SendAll(int fd, string_view data) {
+		while (!data.empty()) {
+			const ssize_t sent = ::send(fd, data.data(), data.size(), 0);
+			if (sent < 0 && errno == EINTR) {
+				continue;
+			}
+			if (sent <= 0) {
+				return false;
+			}
+			data.remove_prefix(static_cast<size_t>(sent));
+		}
+		return true;
+	}
+
+	// Читает строки, пока клиент не закроет соединение. Строка может прийти частями, поэтому
+	// недочитанный хвост копится в buffer, а '\n' ищется только в новых данных
+	void ServeConnection(SnapshotHolder& holder, int fd) {
+		string buffer;
+		size_t scanned = 0;
+		char chunk[1 << 16];
+		for (;;) {
+			const ssize_t received = ::recv(fd, chunk, sizeof(chunk), 0);
+			if (received < 0 && errno == EINTR) {
+				continue;
+			}
+			if (received <= 0) {
+				break;
+			}
+			buffer.append(chunk, static_cast<size_t>(received));
+
+			size_t line_begin = 0;
+			for (size_t newline = buffer.find('\n', scanned); newline != string::npos; newline = buffer.find('\n', line_begin)) {
+				string_view line(buffer.data() + line_begin, newline - line_begin);
+				if (!line.empty() && line.back() == '\r') {
+					line.remove_suffix(1);
+				}
+				line_begin = newline + 1;
+				if (!line.empty() && !SendAll(fd, AnswerLine(holder, line))) {
+					::close(fd);
+					return;
+				}
+			}
+			buffer.erase(0, line_begin);
+			scanned = buffer.size();
+		}
+		::close(fd);
+	}
+
+	// SIGHUP принимает отдельный поток через sigwait. Сигнал блокируется до запуска любых потоков,
+	// чтобы его не получил поток, который не готов его обработать
+	sigset_t BlockReloadSignal() {
+		sigset_t signals;
+		sigemptyset(&signals);
+		sigaddset(&signals, SIGHUP);
+		pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+		return signals;
+	}
+
+	void ReloadOnSignal(SnapshotHolder& holder, sigset_t signals) {
+		for (;;) {
+			int signal_number = 0;
+			if (sigwait(&signals, &signal_number) != 0) {
+				continue;
+			}
+			try {
+				holder.RequestReload().get();
+				cerr << "Data base reloaded\n"sv;
+			}
+			catch (const exception& e) {
+				cerr << "Data base reload failed: "sv << e.what() << '\n';
+			}
+		}
+	}
+
+#endif
+
+} // namespace
+
+void Serve(std::function<json::StatBase()> load_base, const ServerSettings& settings, size_t thread_count) {
+#ifdef TRANSPORT_SERVER_SOCKETS
+	// Запись в сокет закрытого клиентом соединения не должна завершать процесс
+	signal(SIGPIPE, SIG_IGN);
+	const sigset_t reload_signals = BlockReloadSignal();
+
+	// Потоки соединений и сигналов отсоединены, поэтому holder принадлежит им всем, а не стеку Serve
+	const auto holder = make_shared<SnapshotHolder>(std::move(load_base), thread_count);
+	const int listen_fd = Listen(settings);
+	thread([holder, reload_signals]() {
+		ReloadOnSignal(*holder, reload_signals);
+	}).detach();
+	for (;;) {
+		const int fd = ::accept(listen_fd, nullptr, nullptr);
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) {
+				continue;
+			}
+			throw SocketError("Can't accept connection"s);
+		}
+		thread([holder, fd]() {
+			try {
+				ServeConnection(*holder, fd);
+			}
+			catch (...) {
+				::close(fd);
+			}
+		}).detach();
+	}
+#else
+	(void)load_base;
+	(void)settings;
+	(void)thread_count;
+	(void)AnswerLine;
+	throw runtime_error("serve mode is not supported on this platform"s);
+#endif
+}
+
+} // namespace server
+} // namespace transport
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "json_reader.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace transport {
+namespace server {
+
+	// Где принимать соединения: Unix-сокет по пути socket_path либо TCP-порт на 127.0.0.1
+	struct ServerSettings {
+		std::string socket_path;
+		std::optional<uint16_t> port;
+	};
+
+	// База вместе с отвечающим по ней StatReader. Публикуются они вместе, поэтому пакет запросов
+	// целиком отвечается по одной версии базы
+	struct Snapshot {
+		Snapshot(json::StatBase loaded_base, size_t thread_count);
+
+		json::StatBase base;
+		json::StatReader reader;
+	};
+
+	// Текущий снимок базы с подсчётом ссылок. Get берёт снимок атомарно: начатые пакеты доотвечаются
+	// по старому снимку, а следующие после перезагрузки идут уже по новому.
+	// Базу загружает отдельный поток перезагрузки, он же освобождает снимки, которые отпустил
+	// последний запрос, чтобы это не задерживало ответ
+	class SnapshotHolder {
+	public:
+		SnapshotHolder(std::function<json::StatBase()> load_base, size_t thread_count);
+		~SnapshotHolder();
+
+		SnapshotHolder(const SnapshotHolder&) = delete;
+		SnapshotHolder& operator=(const SnapshotHolder&) = delete;
+
+		std::shared_ptr<const Snapshot> Get() const;
+		// Ставит перезагрузку в очередь. future готов, когда новый снимок опубликован, или содержит ошибку
+		// загрузки, и тогда остаётся прежний снимок. Запросы, накопившиеся за время загрузки,
+		// выполняет одна следующая загрузка
+		std::future<void> RequestReload();
+
+	private:
+		std::function<json::StatBase()> load_base_;
+		size_t thread_count_;
+
+		std::mutex mutex_;
+		std::condition_variable queue_cv_;
+		std::vector<std::promise<void>> reload_requests_;
+		std::vector<const Snapshot*> retired_;
+		bool stopping_ = false;
+		std::thread reload_thread_;
+		// Объявлен последним: при разрушении его удалитель обращается к mutex_
+		std::shared_ptr<const Snapshot> snapshot_;
+
+		std::shared_ptr<const Snapshot> MakeSnapshot();
+		void Retire(const Snapshot* snapshot);
+		void RunReloads();
+	};
+
+	// Долгоживущий режим serve: база загружается один раз, клиенты присылают пакеты запросов.
+	// Протокол построчный: каждая строка — JSON-массив stat_requests (или словарь с ключом stat_requests),
+	// в ответ приходит строка с массивом ответов в формате process_requests. Если пакет не удалось разобрать
+	// или ответить на него, возвращается строка {"error": "..."}, а соединение остаётся открытым.
+	// Строка {"control": "reload"} или сигнал SIGHUP перезагружают базу через load_base в потоке перезагрузки,
+	// не останавливая ответы на запросы; на управляющую строку ответ {"reloaded": true} приходит после публикации
+	// новой базы. Каждое соединение обслуживает свой поток, владеющий SnapshotHolder вместе с остальными.
+	// Возвращает управление только исключением, если не удалось загрузить базу или открыть сокет
+	void Serve(std::function<json::StatBase()> load_base, const ServerSettings& settings, size_t thread_count);
+
+} // namespace server
+} // namespace transport
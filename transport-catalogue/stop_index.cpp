@@ -0,0 +1,214 @@
+#define _USE_MATH_DEFINES
+
+#include "stop_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+using namespace std;
+
+namespace transport {
+
+	namespace {
+		constexpr double DEG_TO_RAD = M_PI / 180.;
+		// Запас на погрешность ComputeDistance, чтобы не потерять остановку ровно на границе радиуса
+		constexpr double RADIUS_MARGIN = 1e-9;
+	}
+
+	StopIndex::StopIndex(std::vector<geo::PreparedCoordinates> points)
+		: points_(move(points)) {
+		if (points_.empty()) {
+			cell_offsets_ = std::vector<uint32_t>{ 0 };
+			return;
+		}
+
+		geo::Coordinates max = points_.front().coordinates;
+		grid_.min = points_.front().coordinates;
+		for (const geo::PreparedCoordinates& point : points_) {
+			const geo::Coordinates& coords = point.coordinates;
+			grid_.min = { std::min(grid_.min.lat, coords.lat), std::min(grid_.min.lng, coords.lng) };
+			max = { std::max(max.lat, coords.lat), std::max(max.lng, coords.lng) };
+		}
+
+		// Около двух остановок на ячейку
+		const uint32_t side = std::max<uint32_t>(1, static_cast<uint32_t>(std::sqrt(points_.size() / 2.0)));
+		grid_.rows = side;
+		grid_.columns = side;
+		grid_.cell_lat = max.lat > grid_.min.lat ? (max.lat - grid_.min.lat) / side : 1;
+		grid_.cell_lng = max.lng > grid_.min.lng ? (max.lng - grid_.min.lng) / side : 1;
+
+		std::vector<uint32_t> cells(points_.size());
+		std::vector<uint32_t> cell_offsets(size_t{ grid_.rows } * grid_.columns + 1, 0);
+		for (size_t stop_id = 0; stop_id < points_.size(); ++stop_id) {
+			const geo::Coordinates& coords = points_[stop_id].coordinates;
+			cells[stop_id] = GetRow(coords.lat) * grid_.columns + GetColumn(coords.lng);
+			++cell_offsets[cells[stop_id] + 1];
+		}
+		partial_sum(cell_offsets.begin(), cell_offsets.end(), cell_offsets.begin());
+
+		std::vector<uint32_t> stop_ids(points_.size());
+		std::vector<uint32_t> next(cell_offsets.begin(), cell_offsets.end() - 1);
+		for (size_t stop_id = 0; stop_id < points_.size(); ++stop_id) {
+			stop_ids[next[cells[stop_id]]++] = static_cast<uint32_t>(stop_id);
+		}
+		cell_offsets_ = move(cell_offsets);
+		stop_ids_ = move(stop_ids);
+	}
+
+	StopIndex::StopIndex(std::vector<geo::PreparedCoordinates> points, Grid grid,
+		std::vector<uint32_t> cell_offsets, std::vector<uint32_t> stop_ids)
+		: points_(move(points))
+		, grid_(grid)
+		, cell_offsets_(move(cell_offsets))
+		, stop_ids_(move(stop_ids)) {
+		if (!IsValidGrid()
+			|| !is_sorted(cell_offsets_.begin(), cell_offsets_.end())
+			|| any_of(stop_ids_.begin(), stop_ids_.end(), [this](uint32_t id) { return id >= points_.size(); })) {
+			throw std::logic_error("Data base is broken: stop index");
+		}
+	}
+
+	StopIndex::StopIndex(ranges::Storage<geo::PreparedCoordinates> points, Grid grid,
+		ranges::Storage<uint32_t> cell_offsets, ranges::Storage<uint32_t> stop_ids)
+		: points_(move(points))
+		, grid_(grid)
+		, cell_offsets_(move(cell_offsets))
+		, stop_ids_(move(stop_ids)) {
+		if (!IsValidGrid()) {
+			throw std::logic_error("Data base is broken: stop index");
+		}
+	}
+
+	bool StopIndex::IsValidGrid() const {
+		const bool valid_grid = points_.empty()
+			|| (grid_.rows > 0 && grid_.columns > 0 && grid_.cell_lat > 0 && grid_.cell_lng > 0);
+		return valid_grid
+			&& cell_offsets_.size() == size_t{ grid_.rows } * grid_.columns + 1
+			&& cell_offsets_.front() == 0
+			&& cell_offsets_.back() == stop_ids_.size()
+			&& stop_ids_.size() == points_.size();
+	}
+
+	const StopIndex::Grid& StopIndex::GetGrid() const {
+		return grid_;
+	}
+
+	const ranges::Storage<geo::PreparedCoordinates>& StopIndex::GetPoints() const {
+		return points_;
+	}
+
+	const ranges::Storage<uint32_t>& StopIndex::GetCellOffsets() const {
+		return cell_offsets_;
+	}
+
+	const ranges::Storage<uint32_t>& StopIndex::GetStopIds() const {
+		return stop_ids_;
+	}
+
+	uint32_t StopIndex::GetRow(double lat) const {
+		const double row = std::floor((lat - grid_.min.lat) / grid_.cell_lat);
+		return static_cast<uint32_t>(std::clamp(row, 0.0, static_cast<double>(grid_.rows - 1)));
+	}
+
+	uint32_t StopIndex::GetColumn(double lng) const {
+		const double column = std::floor((lng - grid_.min.lng) / grid_.cell_lng);
+		return static_cast<uint32_t>(std::clamp(column, 0.0, static_cast<double>(grid_.columns - 1)));
+	}
+
+	// По широте остановка дальше radius, если разница широт больше radius / R.
+	// По долготе оцениваем через гаверсинус: hav(d / R) >= cos(lat1) * cos(lat2) * hav(dlng),
+	// где cos(lat2) не меньше косинуса самой дальней от экватора широты полосы.
+	// Окно долгот, вышедшее за ±180°, продолжается с другой стороны антимеридиана вторым диапазоном столбцов
+	std::vector<StopIndex::Found> StopIndex::FindInRadius(geo::Coordinates center, double radius) const {
+		std::vector<Found> result;
+		if (points_.empty() || radius < 0) {
+			return result;
+		}
+
+		const double angle = radius / geo::EARTH_RADIUS * (1 + RADIUS_MARGIN);
+		uint32_t first_row = 0;
+		uint32_t last_row = grid_.rows - 1;
+		std::pair<uint32_t, uint32_t> column_ranges[2] = { { 0, grid_.columns - 1 } };
+		size_t column_range_count = 1;
+		if (angle < M_PI) {
+			const double dlat = angle / DEG_TO_RAD;
+			first_row = GetRow(center.lat - dlat);
+			last_row = GetRow(center.lat + dlat);
+
+			const double max_abs_lat = std::max(std::abs(center.lat - dlat), std::abs(center.lat + dlat));
+			const double cos_product = std::cos(center.lat * DEG_TO_RAD) * std::cos(std::min(max_abs_lat, 90.) * DEG_TO_RAD);
+			const double half_angle_sin = std::sin(angle / 2);
+			if (max_abs_lat < 90 && cos_product > 0 && half_angle_sin * half_angle_sin < cos_product) {
+				const double dlng = 2 * std::asin(std::sqrt(half_angle_sin * half_angle_sin / cos_product)) / DEG_TO_RAD;
+				const double lng = std::remainder(center.lng, 360.);
+				const double west = lng - dlng;
+				const double east = lng + dlng;
+				column_ranges[0] = { GetColumn(std::max(west, -180.)), GetColumn(std::min(east, 180.)) };
+				if (west < -180) {
+					column_ranges[column_range_count++] = { GetColumn(west + 360), grid_.columns - 1 };
+				}
+				else if (east > 180) {
+					column_ranges[column_range_count++] = { 0, GetColumn(east - 360) };
+				}
+				// После прижатия к сетке диапазоны могут пересечься, а остановку нельзя найти дважды
+				if (column_range_count == 2
+					&& std::max(column_ranges[0].first, column_ranges[1].first) <= std::min(column_ranges[0].second, column_ranges[1].second) + 1) {
+					column_ranges[0] = { std::min(column_ranges[0].first, column_ranges[1].first),
+						std::max(column_ranges[0].second, column_ranges[1].second) };
+					column_range_count = 1;
+				}
+			}
+		}
+
+		const geo::PreparedCoordinates center_point = geo::Prepare(center);
+		for (uint32_t row = first_row; row <= last_row; ++row) {
+			for (size_t range = 0; range < column_range_count; ++range) {
+				for (uint32_t column = column_ranges[range].first; column <= column_ranges[range].second; ++column) {
+					const size_t cell = size_t{ row } * grid_.columns + column;
+					const uint32_t end = cell_offsets_[cell + 1];
+					if (cell_offsets_[cell] > end || end > stop_ids_.size()) {
+						throw std::logic_error("Data base is broken: stop index");
+					}
+					for (uint32_t i = cell_offsets_[cell]; i < end; ++i) {
+						if (stop_ids_[i] >= points_.size()) {
+							throw std::logic_error("Data base is broken: stop index");
+						}
+						const double distance = geo::ComputeDistance(center_point, points_[stop_ids_[i]]);
+						if (distance <= radius) {
+							result.push_back({ stop_ids_[i], distance });
+						}
+					}
+				}
+			}
+		}
+
+		sort(result.begin(), result.end(), [](const Found& lhs, const Found& rhs) {
+			return std::tie(lhs.distance, lhs.stop_id) < std::tie(rhs.distance, rhs.stop_id);
+		});
+		return result;
+	}
+
+	// Ищем в радиусе, удваивая его, пока не наберётся count остановок: все остановки внутри радиуса
+	// найдены, значит count ближайших среди них. Радиус в половину окружности Земли покрывает всё
+	std::vector<StopIndex::Found> StopIndex::FindNearest(geo::Coordinates center, size_t count) const {
+		if (count == 0 || points_.empty()) {
+			return {};
+		}
+
+		const double max_radius = M_PI * geo::EARTH_RADIUS;
+		double radius = std::max(grid_.cell_lat, grid_.cell_lng) * DEG_TO_RAD * geo::EARTH_RADIUS;
+		for (;;) {
+			std::vector<Found> result = FindInRadius(center, std::min(radius, max_radius));
+			if (result.size() >= count || radius >= max_radius) {
+				result.resize(std::min(result.size(), count));
+				return result;
+			}
+			radius *= 2;
+		}
+	}
+
+} // namespace transport
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "geo.h"
+#include "ranges.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace transport {
+
+	// Сетка над координатами остановок для поиска ближайших остановок без перебора всех.
+	// Ячейки хранятся в CSR: id остановок ячейки cell лежат в stop_ids[cell_offsets[cell]..cell_offsets[cell + 1]).
+	// Строится при make_base и сохраняется в базе
+	class StopIndex {
+	public:
+		struct Grid {
+			geo::Coordinates min{ 0, 0 };
+			// Размер ячейки в градусах
+			double cell_lat = 1;
+			double cell_lng = 1;
+			uint32_t rows = 0;
+			uint32_t columns = 0;
+		};
+
+		struct Found {
+			size_t stop_id;
+			double distance;
+		};
+
+		StopIndex() = default;
+		// points[i] — координаты остановки с id i
+		explicit StopIndex(std::vector<geo::PreparedCoordinates> points);
+		// Собирает индекс из частей, сохранённых в базе, и проверяет их согласованность
+		StopIndex(std::vector<geo::PreparedCoordinates> points, Grid grid,
+			std::vector<uint32_t> cell_offsets, std::vector<uint32_t> stop_ids);
+		// Собирает индекс из массивов, которые могут ссылаться на отображённую в память базу.
+		// Проверяются только размеры, смещения ячеек и id остановок — при поиске
+		StopIndex(ranges::Storage<geo::PreparedCoordinates> points, Grid grid,
+			ranges::Storage<uint32_t> cell_offsets, ranges::Storage<uint32_t> stop_ids);
+
+		const Grid& GetGrid() const;
+		const ranges::Storage<geo::PreparedCoordinates>& GetPoints() const;
+		const ranges::Storage<uint32_t>& GetCellOffsets() const;
+		const ranges::Storage<uint32_t>& GetStopIds() const;
+
+		// Остановки не дальше radius метров по возрастанию расстояния
+		std::vector<Found> FindInRadius(geo::Coordinates center, double radius) const;
+		// count ближайших остановок по возрастанию расстояния
+		std::vector<Found> FindNearest(geo::Coordinates center, size_t count) const;
+
+	private:
+		ranges::Storage<geo::PreparedCoordinates> points_;
+		Grid grid_;
+		ranges::Storage<uint32_t> cell_offsets_;
+		ranges::Storage<uint32_t> stop_ids_;
+
+		uint32_t GetRow(double lat) const;
+		uint32_t GetColumn(double lng) const;
+		bool IsValidGrid() const;
+	};
+
+} // namespace transport
@@ -37,6 +37,76 @@ std::ostream& operator<<(std::ostream& os, StrokeLineJoin stroke_line_join) {
     return os;
 }
     
+void RenderPathAttrs(std::ostream& out, const PathAttrs& attrs) {
+    if (attrs.fill_color) {
+        out << " fill=\""sv << *attrs.fill_color << "\""sv;
+    }
+    if (attrs.stroke_color) {
+        out << " stroke=\""sv << *attrs.stroke_color << "\""sv;
+    }
+    if (attrs.stroke_width) {
+        out << " stroke-width=\""sv << *attrs.stroke_width << "\""sv;
+    }
+    if (attrs.stroke_linecap) {
+        out << " stroke-linecap=\""sv << *attrs.stroke_linecap << "\""sv;
+    }
+    if (attrs.stroke_linejoin) {
+        out << " stroke-linejoin=\""sv << *attrs.stroke_linejoin << "\""sv;
+    }
+}
+
+namespace {
+
+// Выводит текст, экранируя спецсимволы XML; неэкранируемые участки пишутся целиком
+void RenderEscaped(std::ostream& out, std::string_view text) {
+    size_t begin = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        std::string_view escaped;
+        switch (text[i]) {
+            case '\"': escaped = "&quot;"sv; break;
+            case '\'': escaped = "&apos;"sv; break;
+            case '<': escaped = "&lt;"sv; break;
+            case '>': escaped = "&gt;"sv; break;
+            case '&': escaped = "&amp;"sv; break;
+            default: continue;
+        }
+        out.write(text.data() + begin, static_cast<std::streamsize>(i - begin));
+        out << escaped;
+        begin = i + 1;
+    }
+    out.write(text.data() + begin, static_cast<std::streamsize>(text.size() - begin));
+}
+
+void RenderCircle(std::ostream& out, Point center, double radius, const PathAttrs& attrs) {
+    out << "<circle cx=\""sv << center.x << "\" cy=\""sv << center.y << "\" "sv;
+    out << "r=\""sv << radius << "\""sv;
+    RenderPathAttrs(out, attrs);
+    out << "/>"sv;
+}
+
+void RenderText(std::ostream& out, const TextAttrs& text, std::string_view data, const PathAttrs& attrs) {
+    out << "<text"sv;
+    RenderPathAttrs(out, attrs);
+
+    out << " x=\""sv << text.position.x << "\""sv;
+    out << " y=\""sv << text.position.y << "\""sv;
+    out << " dx=\""sv << text.offset.x << "\""sv;
+    out << " dy=\""sv << text.offset.y << "\""sv;
+    out << " font-size=\""sv << text.font_size << "\""sv;
+    if (!text.font_family.empty()) {
+        out << " font-family=\""sv << text.font_family << "\""sv;
+    }
+    if (!text.font_weight.empty()) {
+        out << " font-weight=\""sv << text.font_weight << "\""sv;
+    }
+
+    out << ">"sv;
+    RenderEscaped(out, data);
+    out << "</text>"sv;
+}
+
+}  // namespace
+
 // Добавляет в svg-документ объект-наследник svg::Object
 void Document::AddPtr(std::unique_ptr<Object>&& obj) {
     objects_.push_back(std::move(obj));
@@ -74,11 +144,7 @@ Circle& Circle::SetRadius(double radius)  {
 }
 
 void Circle::RenderObject(const RenderContext& context) const {
-    auto& out = context.out;
-    out << "<circle cx=\""sv << center_.x << "\" cy=\""sv << center_.y << "\" "sv;
-    out << "r=\""sv << radius_ << "\""sv;
-    RenderAttrs(out);
-    out << "/>"sv;
+    RenderCircle(context.out, center_, radius_, GetAttrs());
 }
     
 Polyline& Polyline::AddPoint(Point point) {
@@ -135,59 +201,60 @@ Text& Text::SetData(std::string data) {
     return *this;
 }
     
-std::string Text::ShieldingString(const std::string& src) const {
-    std::string ret;
-    ret.reserve(src.size() * 2);
-    for(char c: src) {
-        switch(c) {
-            case '\"':
-                ret += "&quot;";
-                break;
-            case '\'':
-                ret += "&apos;";
-                break;
-            case '<':
-                ret += "&lt;";
-                break;
-             case '>':
-                ret += "&gt;";
-                break;
-            case '&':
-                ret += "&amp;";
-                break;
-            default:
-                ret.push_back(c);
-                break;
-        }
-    }
-    return ret;
-}
-    
 void Text::RenderObject(const RenderContext& context) const {
-    auto& out = context.out;
-    out << "<text"sv;
-    
-    RenderAttrs(out);
-    
-    out << " x=\"" << pos_.x << "\"";
-    out << " y=\"" << pos_.y << "\"";   
-        
-    out << " dx=\"" << offset_.x << "\"";
-    out << " dy=\"" << offset_.y << "\"";  
-    
-    out << " font-size=\"" << size_ << "\"";  
+    RenderText(context.out, { pos_, offset_, size_, font_family_, font_weight_ }, data_, GetAttrs());
+}
 
-    if(font_family_.size()) {
-        out << " font-family=\"" << font_family_ << "\"";
+// ---------- StreamDocument ------------------
+StreamDocument::StreamDocument(std::ostream& out, std::optional<ViewBox> view_box)
+    : out_(out) {
+    out_ << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"sv;
+    out_ << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\""sv;
+    if (view_box) {
+        out_ << " viewBox=\""sv << view_box->min.x << ' ' << view_box->min.y << ' '
+            << view_box->width << ' ' << view_box->height << "\""sv;
     }
-    
-    if(font_weight_.size()) {
-        out << " font-weight=\"" << font_weight_ << "\"";
+    out_ << ">\n"sv;
+}
+
+StreamDocument& StreamDocument::AddCircle(Point center, double radius, const PathAttrs& attrs) {
+    out_ << "  "sv;
+    RenderCircle(out_, center, radius, attrs);
+    out_ << '\n';
+    return *this;
+}
+
+StreamDocument& StreamDocument::StartPolyline() {
+    out_ << "  <polyline points=\""sv;
+    first_point_ = true;
+    return *this;
+}
+
+StreamDocument& StreamDocument::AddPolylinePoint(Point point) {
+    if (!first_point_) {
+        out_ << ' ';
     }
-    
-    out << ">";
-    out << ShieldingString(data_);
-    out << "</text>";
+    first_point_ = false;
+    out_ << point;
+    return *this;
+}
+
+StreamDocument& StreamDocument::EndPolyline(const PathAttrs& attrs) {
+    out_ << "\""sv;
+    RenderPathAttrs(out_, attrs);
+    out_ << "/>\n"sv;
+    return *this;
+}
+
+StreamDocument& StreamDocument::AddText(const TextAttrs& text, std::string_view data, const PathAttrs& attrs) {
+    out_ << "  "sv;
+    RenderText(out_, text, data, attrs);
+    out_ << '\n';
+    return *this;
+}
+
+void StreamDocument::Finish() {
+    out_ << "</svg>"sv;
 }
 
 }  // namespace svg
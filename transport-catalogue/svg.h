@@ -4,6 +4,7 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <optional>
 
@@ -75,6 +76,30 @@ struct RenderContext {
     int indent = 0;
 };
     
+/*
+ * Атрибуты оформления фигуры. Цвета хранятся как string_view и должны жить до вывода элемента
+ */
+struct PathAttrs {
+    std::optional<std::string_view> fill_color;
+    std::optional<std::string_view> stroke_color;
+    std::optional<double> stroke_width;
+    std::optional<StrokeLineCap> stroke_linecap;
+    std::optional<StrokeLineJoin> stroke_linejoin;
+};
+
+void RenderPathAttrs(std::ostream& out, const PathAttrs& attrs);
+
+/*
+ * Атрибуты элемента <text>, кроме оформления и самого текста
+ */
+struct TextAttrs {
+    Point position;
+    Point offset;
+    uint32_t font_size = 1;
+    std::string_view font_family;
+    std::string_view font_weight;
+};
+
 template <typename Owner>
 class PathProps {
 public:
@@ -103,25 +128,22 @@ public:
 protected:
     ~PathProps() = default;
 
-    void RenderAttrs(std::ostream& out) const {
-        using namespace std::literals;
-
+    PathAttrs GetAttrs() const {
+        PathAttrs attrs;
         if (fill_color_) {
-            out << " fill=\""sv << *fill_color_ << "\""sv;
+            attrs.fill_color = *fill_color_;
         }
         if (stroke_color_) {
-            out << " stroke=\""sv << *stroke_color_ << "\""sv;
-        }
-        
-        if (stroke_width_) {
-            out << " stroke-width=\""sv << *stroke_width_ << "\""sv;
-        }
-        if (stroke_linecap_) {
-            out << " stroke-linecap=\""sv << *stroke_linecap_ << "\""sv;
-        }
-        if (stroke_linejoin_) {
-            out << " stroke-linejoin=\""sv << *stroke_linejoin_ << "\""sv;
+            attrs.stroke_color = *stroke_color_;
         }
+        attrs.stroke_width = stroke_width_;
+        attrs.stroke_linecap = stroke_linecap_;
+        attrs.stroke_linejoin = stroke_linejoin_;
+        return attrs;
+    }
+
+    void RenderAttrs(std::ostream& out) const {
+        RenderPathAttrs(out, GetAttrs());
     }
 
 private:
@@ -220,8 +242,6 @@ public:
     
     
     void RenderObject(const RenderContext& context) const override;
-    std::string ShieldingString(const std::string& src) const;
-    //std::string UnshieldingString(const std::string& src);
 };
     
 class ObjectContainer {
@@ -249,6 +269,40 @@ public:
     std::vector<std::unique_ptr<Object>> objects_;
 };
     
+/*
+ * Видимая область документа (атрибут viewBox)
+ */
+struct ViewBox {
+    Point min;
+    double width = 0;
+    double height = 0;
+};
+
+/*
+ * Выводит SVG-документ прямо в поток по мере добавления элементов, ничего не храня.
+ * Для тех же элементов в том же порядке вывод совпадает с Document::Render.
+ * Заголовок пишется в конструкторе, закрывающий тег — в Finish
+ */
+class StreamDocument {
+public:
+    explicit StreamDocument(std::ostream& out, std::optional<ViewBox> view_box = std::nullopt);
+
+    StreamDocument& AddCircle(Point center, double radius, const PathAttrs& attrs);
+
+    // Ломаная выводится по частям: StartPolyline, AddPolylinePoint на каждую вершину, EndPolyline
+    StreamDocument& StartPolyline();
+    StreamDocument& AddPolylinePoint(Point point);
+    StreamDocument& EndPolyline(const PathAttrs& attrs);
+
+    StreamDocument& AddText(const TextAttrs& text, std::string_view data, const PathAttrs& attrs);
+
+    void Finish();
+
+private:
+    std::ostream& out_;
+    bool first_point_ = true;
+};
+
     template<class ObjectChild>
     void ObjectContainer::Add(ObjectChild obj) {
         AddPtr(std::make_unique<ObjectChild>(std::move(obj)));
@@ -1,4 +1,5 @@
 #include "transport_catalogue.h"
+#include "parallel.h"
 
 #include <numeric>
 #include <stdexcept>
@@ -12,12 +13,34 @@ namespace transport {
 
 	void TransportCatalogue::AddStop(std::string name, geo::Coordinates coordinates) {
 		size_t id = stops_storage_.size();
-		stops_storage_.push_back(Stop{move(name), move(coordinates)});
+		stops_storage_.push_back(Stop{move(name), move(coordinates), id});
+		stop_points_.push_back(geo::Prepare(stops_storage_.back().coordinates_));
 		Stop* pstop = &stops_storage_.back();
 		stops_[pstop->name_] = id;
 		buses_of_stop_[pstop];
 	}
 
+	void TransportCatalogue::AddBusWithStopIds(std::string name, bool circular, const std::vector<size_t>& stop_ids) {
+		std::unordered_set<Stop*> stops_set;
+
+		const size_t stops_offset = bus_stop_ids_.size();
+		for (size_t stop_id : stop_ids) {
+			stops_set.insert(&stops_storage_.at(stop_id));
+			bus_stop_ids_.push_back(stop_id);
+		}
+
+		size_t id = buses_storage_.size();
+		buses_storage_.push_back(Bus{
+			move(name), circular, stops_offset, stop_ids.size(), move(stops_set), id
+		});
+		Bus* pbus = &buses_storage_.back();
+
+		buses_[pbus->name_] = id;
+		for (Stop* pstop : pbus->stops_set_) {
+			buses_of_stop_[pstop].insert(pbus);
+		}
+	}
+
 	set<string> TransportCatalogue::GetBusesNamesFromStop(const Stop* stop) const {
 		set<string> ret;
 
@@ -28,7 +51,12 @@ namespace transport {
 	}
 
 	size_t TransportCatalogue::GetStopsCount(const Bus *bus) const {
-		return bus->circular_ ? bus->stops_.size() : bus->stops_.size() * 2 - 1;
+		return bus->circular_ ? bus->stops_count_ : bus->stops_count_ * 2 - 1;
+	}
+
+	TransportCatalogue::StopIds TransportCatalogue::GetBusStopIds(const Bus* bus) const {
+		const size_t* begin = bus_stop_ids_.data() + bus->stops_offset_;
+		return { begin, begin + bus->stops_count_ };
 	}
 
 	size_t TransportCatalogue::GetUniqueStopsCount(const Bus* bus) const {
@@ -36,67 +64,94 @@ namespace transport {
 	}
 
 	double TransportCatalogue::GetGeoLength(const Bus* bus) const {
-		double res = transform_reduce(
-			++bus->stops_.begin(), bus->stops_.end(),
-			bus->stops_.begin(),
-			0.0,
-			plus<>(),
-			ComputeDistance
-		);
+		const StopIds stop_ids = GetBusStopIds(bus);
+		const double res = geo::ComputeRouteLength(stop_points_.data(), stop_points_.size(), stop_ids.begin(), stop_ids.end());
 
 		return bus->circular_ ? res : res * 2;
 	}
 
 	size_t TransportCatalogue::GetLengthFromTo(size_t from_id, size_t to_id) const {
-		return GetLengthFromTo(&stops_storage_[from_id], &stops_storage_[to_id]);
+		return road_distances_.Get(from_id, to_id);
 	}
 
 	size_t TransportCatalogue::GetLengthFromTo(const Stop* from, const Stop* to) const {
-		auto it = length_from_to_.find({ from, to }); 
-		if(it == length_from_to_.end()) {
-			it = length_from_to_.find({ to, from });
-			if(it == length_from_to_.end()) {
-                return 0;
-            }
-		}
-		return it->second;
+		return road_distances_.Get(from->id_, to->id_);
 	}
 
 	size_t TransportCatalogue::GetLength(const Bus* bus) const {
-		size_t res = 0;
-
-		auto get_length_to = [this](const auto& lhs, const auto& rhs) {
-			return this->GetLengthFromTo(rhs, lhs);
-		};
+		const StopIds stop_ids = GetBusStopIds(bus);
+		if (stop_ids.begin() == stop_ids.end()) {
+			return 0;
+		}
 
-		res = transform_reduce(
-			++bus->stops_.begin(), bus->stops_.end(),
-			bus->stops_.begin(),
-			res,
-			plus<>(),
-			get_length_to
-		);
+		size_t res = 0;
+		for (const size_t* it = stop_ids.begin(); it + 1 != stop_ids.end(); ++it) {
+			res += GetLengthFromTo(*it, *(it + 1));
+		}
 
-		Stop* first = bus->stops_.front();
+		const size_t first = *stop_ids.begin();
 		res += GetLengthFromTo(first, first);
 		if (bus->circular_) {
 			return res;
 		}
 
-		Stop* last = bus->stops_.back();
+		const size_t last = *(stop_ids.end() - 1);
 		res += GetLengthFromTo(last, last);
 
-		res = transform_reduce(
-			++bus->stops_.rbegin(), bus->stops_.rend(),
-			bus->stops_.rbegin(),
-			res,
-			plus<>(),
-			get_length_to
-		);
+		for (const size_t* it = stop_ids.begin(); it + 1 != stop_ids.end(); ++it) {
+			res += GetLengthFromTo(*(it + 1), *it);
+		}
 
 		return res;
 	}
 
+	void TransportCatalogue::ComputeBusStats() {
+		std::vector<BusStat> bus_stats(buses_storage_.size());
+		parallel::ForEachIndex(buses_storage_.size(), [this, &bus_stats](size_t bus_id) {
+			bus_stats[bus_id] = ComputeBusStat(&buses_storage_[bus_id]);
+		});
+		bus_stats_ = move(bus_stats);
+	}
+
+	void TransportCatalogue::SetBusStats(std::vector<BusStat> bus_stats) {
+		if (bus_stats.size() != buses_storage_.size()) {
+			throw std::logic_error("Bus stats count does not match bus count");
+		}
+		bus_stats_ = move(bus_stats);
+	}
+
+	const std::vector<BusStat>& TransportCatalogue::GetBusStats() const {
+		return bus_stats_;
+	}
+
+	void TransportCatalogue::BuildStopIndex() {
+		stop_index_ = StopIndex(stop_points_);
+	}
+
+	void TransportCatalogue::SetStopIndex(StopIndex::Grid grid, std::vector<uint32_t> cell_offsets, std::vector<uint32_t> stop_ids) {
+		stop_index_ = StopIndex(stop_points_, grid, move(cell_offsets), move(stop_ids));
+	}
+
+	const StopIndex& TransportCatalogue::GetStopIndex() const {
+		return stop_index_;
+	}
+
+	BusStat TransportCatalogue::GetBusStat(const Bus* bus) const {
+		if (bus->id_ < bus_stats_.size()) {
+			return bus_stats_[bus->id_];
+		}
+		return ComputeBusStat(bus);
+	}
+
+	BusStat TransportCatalogue::ComputeBusStat(const Bus* bus) const {
+		BusStat ret;
+		ret.route_length = GetLength(bus);
+		ret.curvature = ret.route_length / GetGeoLength(bus);
+		ret.stop_count = GetStopsCount(bus);
+		ret.unique_stop_count = GetUniqueStopsCount(bus);
+		return ret;
+	}
+
 	const Bus* TransportCatalogue::GetBus(const std::string_view route_name) const noexcept {
 		if(buses_.count(route_name) == 0) {
             return nullptr;
@@ -105,6 +160,10 @@ namespace transport {
 		return &buses_storage_[buses_.at(route_name)];
 	}
 
+	const Bus* TransportCatalogue::GetBusById(size_t bus_id) const {
+		return &buses_storage_.at(bus_id);
+	}
+
 	size_t TransportCatalogue::GetBusIndex(const std::string_view bus_name) const noexcept {
 		if (buses_.count(bus_name) == 0) {
 			return buses_.size();
@@ -121,6 +180,10 @@ namespace transport {
 		return &stops_storage_[stops_.at(stop_name)];
 	}
 
+	const Stop* TransportCatalogue::GetStopById(size_t stop_id) const {
+		return &stops_storage_.at(stop_id);
+	}
+
 	size_t TransportCatalogue::GetStopIndex(const std::string_view stop_name) const noexcept {
 		if (stops_.count(stop_name) == 0) {
 			return stops_.size();
@@ -134,15 +197,19 @@ namespace transport {
 			const Stop* pfrom = GetStop(from);
 			for (auto& [to, length] : to_map) {
 				const Stop* pto = GetStop(to);
-				length_from_to_[{pfrom, pto}] = length;
-				pair pto_pfrom = { pto, pfrom };
-				if (length_from_to_.count(pto_pfrom) == 0) {
-					length_from_to_[pto_pfrom] = length;
-				}
+				SetLengthBetweenStops(pfrom->id_, pto->id_, length);
 			}
 		}
 	}
 
+	void TransportCatalogue::SetLengthBetweenStops(size_t from_id, size_t to_id, size_t length) {
+		if (from_id >= stops_storage_.size() || to_id >= stops_storage_.size()) {
+			throw std::out_of_range("Unknown stop id");
+		}
+		road_distances_.Set(from_id, to_id, length);
+		road_distances_.SetIfAbsent(to_id, from_id, length);
+	}
+
 	const std::deque<Stop>& TransportCatalogue::GetStops() const {
 		return stops_storage_;
 	}
@@ -151,8 +218,8 @@ namespace transport {
 		return buses_storage_;
 	}
 	
-	const TransportCatalogue::length_map& TransportCatalogue::GetLengthMap() const {
-		return length_from_to_;
+	const RoadDistances& TransportCatalogue::GetRoadDistances() const {
+		return road_distances_;
 	}
 }
 
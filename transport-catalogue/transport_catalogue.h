@@ -9,42 +9,55 @@
 #include <set>
 #include <map>
 #include <deque>
+#include <vector>
 #include <functional>
 #include <iostream>
 
 
 
 #include "domain.h"
+#include "ranges.h"
+#include "road_distances.h"
+#include "stop_index.h"
 
 
 namespace transport {
 
 	
 
-	template <typename Pointer>
-	struct PairPointerHasher {
-		size_t operator() (const std::pair<Pointer, Pointer>& f) const {
-			static constexpr std::hash<Pointer> hasher;
-			return hasher(f.first) + hasher(f.second) * 977;
-		}
-	};
-
 	class TransportCatalogue {
 	public:
-		using length_map = std::unordered_map<std::pair<const Stop*, const Stop*>, size_t, PairPointerHasher<const Stop*>>;
+		using StopIds = ranges::Range<const size_t*>;
 		
 		template<typename Container>
 		void AddBus(std::string name, bool circular, const Container& stop_names);
+		void AddBusWithStopIds(std::string name, bool circular, const std::vector<size_t>& stop_ids);
 		const Bus* GetBus(const std::string_view bus_name) const noexcept;
+		const Bus* GetBusById(size_t bus_id) const;
 		size_t GetBusIndex(const std::string_view bus_name) const noexcept;
 		size_t GetStopsCount(const Bus* bus) const;
+		// id остановок маршрута в порядке следования; действительны до следующего AddBus
+		StopIds GetBusStopIds(const Bus* bus) const;
 		size_t GetUniqueStopsCount(const Bus* bus) const;
 		double GetGeoLength(const Bus* bus) const;
 		size_t GetLength(const Bus* bus) const;
 		const std::deque<Bus>& GetBuses() const;
 
+		// Статистика маршрутов по id автобуса считается один раз после заполнения каталога
+		// (или берётся из базы), чтобы запрос Bus не проходил весь маршрут заново
+		void ComputeBusStats();
+		void SetBusStats(std::vector<BusStat> bus_stats);
+		const std::vector<BusStat>& GetBusStats() const;
+		BusStat GetBusStat(const Bus* bus) const;
+
+		// Индекс остановок по координатам строится после добавления всех остановок или берётся из базы
+		void BuildStopIndex();
+		void SetStopIndex(StopIndex::Grid grid, std::vector<uint32_t> cell_offsets, std::vector<uint32_t> stop_ids);
+		const StopIndex& GetStopIndex() const;
+
 		void AddStop(std::string name, geo::Coordinates coordinates);
 		const Stop* GetStop(const std::string_view stop_name) const noexcept;
+		const Stop* GetStopById(size_t stop_id) const;
 		size_t GetStopIndex(const std::string_view stop_name) const noexcept;
 		std::set<std::string> GetBusesNamesFromStop(const Stop*) const;
 		size_t GetLengthFromTo(const Stop* from, const Stop* to) const;
@@ -52,40 +65,36 @@ namespace transport {
 		const std::unordered_set<Bus*>* GetBusesByStop(const Stop*) const;
 
 		void SetLengthBetweenStops(const std::unordered_map<std::string, std::unordered_map<std::string, size_t>>& length_from_to);
+		// Задаёт расстояние from -> to; обратное направление получает то же расстояние, если оно не задано явно
+		void SetLengthBetweenStops(size_t from_id, size_t to_id, size_t length);
 
 		const std::deque<Stop>& GetStops() const;
 		
-		const length_map& GetLengthMap() const;
+		const RoadDistances& GetRoadDistances() const;
 	private:
 		std::deque<Bus> buses_storage_;
 		std::deque<Stop> stops_storage_;
+		std::vector<size_t> bus_stop_ids_;
 		std::unordered_map<std::string_view, size_t> stops_;
 		std::unordered_map<std::string_view, size_t> buses_;
-		length_map length_from_to_;
+		RoadDistances road_distances_;
 		std::unordered_map<const Stop*, std::unordered_set<Bus*>> buses_of_stop_;
+		std::vector<BusStat> bus_stats_;
+		// Координаты остановок по id с посчитанными sin/cos широты для GetGeoLength и индекса остановок
+		std::vector<geo::PreparedCoordinates> stop_points_;
+		StopIndex stop_index_;
+
+		BusStat ComputeBusStat(const Bus* bus) const;
 	};
 
 	template<typename Container>
 	void TransportCatalogue::AddBus(std::string name, bool circular, const Container& stop_names) {
-		ConteinerOfStopPointers stops;
-
-		for (auto& name : stop_names) {
-			stops.push_back(&stops_storage_[stops_[name]]);
-		}
-		std::unordered_set<Stop*> stops_set{ stops.begin(), stops.end() };
-
-		Bus bus{
-			std::move(name), circular, std::move(stops), std::move(stops_set)
-		};
-
-		size_t id = buses_storage_.size();
-		buses_storage_.push_back(std::move(bus));
-		Bus* pbus = &buses_storage_.back();
+		std::vector<size_t> stop_ids;
 
-		buses_[pbus->name_] = id;
-		for (Stop* pstop : pbus->stops_set_) {
-			buses_of_stop_[pstop].insert(pbus);
+		for (auto& stop_name : stop_names) {
+			stop_ids.push_back(stops_.at(stop_name));
 		}
+		AddBusWithStopIds(std::move(name), circular, stop_ids);
 	}
 
 
@@ -1,5 +1,7 @@
 #include "transport_router.h"
+#include "parallel.h"
 
+#include <iterator>
 #include <numeric>
 
 #include <iostream>
@@ -8,22 +10,107 @@
 namespace transport {
 namespace router {
 Router::Router(const TransportCatalogue& transport_catalogue, RouterSettings settings)
-	: graph_{ std::make_unique<Graph>(GraphBuilder(transport_catalogue, settings).Build())}
-	, router_{ graph_->directed_weighted_graph } {
+	: settings_{ settings }
+	, graph_{ std::make_unique<Graph>(GraphBuilder(transport_catalogue, settings).Build())}
+	, router_{ MakeEngine(graph_->directed_weighted_graph, settings_.engine) } {
 }
 
-Router::Router( Graph graph)
-	: graph_{ std::make_unique<Graph>(std::move(graph))}
-	, router_{ graph_->directed_weighted_graph } {
+Router::Router(Graph graph, RouterSettings settings)
+	: settings_{ settings }
+	, graph_{ std::make_unique<Graph>(std::move(graph))}
+	, router_{ MakeEngine(graph_->directed_weighted_graph, settings_.engine) } {
 
 }
 
+Router::Engine Router::MakeEngine(const DirectedGraph& graph, RouterEngine engine) {
+	switch (engine) {
+	case RouterEngine::DIJKSTRA:
+		return Engine{ std::in_place_type<graph::DijkstraRouter<Time, DirectedGraph>>, graph };
+	case RouterEngine::CONTRACTION_HIERARCHY:
+		return Engine{ std::in_place_type<graph::ContractionHierarchyRouter<Time, DirectedGraph>>, graph };
+	case RouterEngine::ALL_PAIRS:
+		break;
+	}
+	return Engine{ std::in_place_type<graph::Router<Time, DirectedGraph>>, graph };
+}
+
+Router::Router(Graph graph, RouterSettings settings, RoutesTable routes)
+	: settings_{ settings }
+	, graph_{ std::make_unique<Graph>(std::move(graph))}
+	, router_{ MakeEngine(graph_->directed_weighted_graph, settings_.engine, std::move(routes)) } {
+
+}
+
+Router::Engine Router::MakeEngine(const DirectedGraph& graph, RouterEngine engine, RoutesTable routes) {
+	if (engine != RouterEngine::ALL_PAIRS) {
+		return MakeEngine(graph, engine);
+	}
+	return Engine{ std::in_place_type<graph::Router<Time, DirectedGraph>>, graph, std::move(routes) };
+}
+
+Router::Router(Graph graph, RouterSettings settings, ContractionHierarchy hierarchy)
+	: settings_{ settings }
+	, graph_{ std::make_unique<Graph>(std::move(graph))}
+	, router_{ MakeEngine(graph_->directed_weighted_graph, settings_.engine, std::move(hierarchy)) } {
+
+}
+
+Router::Engine Router::MakeEngine(const DirectedGraph& graph, RouterEngine engine, ContractionHierarchy hierarchy) {
+	if (engine != RouterEngine::CONTRACTION_HIERARCHY) {
+		return MakeEngine(graph, engine);
+	}
+	return Engine{ std::in_place_type<graph::ContractionHierarchyRouter<Time, DirectedGraph>>, graph, std::move(hierarchy) };
+}
+
+Router::Router(Graph graph, RouterSettings settings, ContractionHierarchy hierarchy, SearchGraph search_graph)
+	: settings_{ settings }
+	, graph_{ std::make_unique<Graph>(std::move(graph))}
+	, router_{ MakeEngine(graph_->directed_weighted_graph, settings_.engine, std::move(hierarchy), std::move(search_graph)) } {
+
+}
+
+Router::Engine Router::MakeEngine(const DirectedGraph& graph, RouterEngine engine, ContractionHierarchy hierarchy,
+	SearchGraph search_graph) {
+	if (engine != RouterEngine::CONTRACTION_HIERARCHY) {
+		return MakeEngine(graph, engine);
+	}
+	return Engine{ std::in_place_type<graph::ContractionHierarchyRouter<Time, DirectedGraph>>, graph, std::move(hierarchy),
+		std::move(search_graph) };
+}
+
 const Graph& Router::GetGraph() const {
 	return *graph_;
 }
 
+const RouterSettings& Router::GetSettings() const {
+	return settings_;
+}
+
+const Router::RoutesTable* Router::GetRoutesTable() const {
+	if (const auto* router = std::get_if<graph::Router<Time, DirectedGraph>>(&router_)) {
+		return &router->GetRoutesTable();
+	}
+	return nullptr;
+}
+
+const Router::ContractionHierarchy* Router::GetContractionHierarchy() const {
+	if (const auto* router = std::get_if<graph::ContractionHierarchyRouter<Time, DirectedGraph>>(&router_)) {
+		return &router->GetHierarchy();
+	}
+	return nullptr;
+}
+
+const Router::SearchGraph* Router::GetSearchGraph() const {
+	if (const auto* router = std::get_if<graph::ContractionHierarchyRouter<Time, DirectedGraph>>(&router_)) {
+		return &router->GetSearchGraph();
+	}
+	return nullptr;
+}
+
 std::optional<Router::RouteInfo> Router::BuildRoute(size_t from_index, size_t to_index) const {
-	auto route = router_.BuildRoute(from_index, to_index);
+	auto route = std::visit([from_index, to_index](const auto& router) {
+		return router.BuildRoute(from_index, to_index);
+	}, router_);
 	if (!route) {
 		return std::nullopt;
 	}
@@ -45,20 +132,68 @@ GraphBuilder::GraphBuilder(const TransportCatalogue& transport_catalogue, Router
 	, bus_velocity_meters_per_min_{ settings_.bus_velocity * 1000 / 60 } {}
 
 Graph GraphBuilder::Build() const {
-	Graph graph{
-		graph::DirectedWeightedGraph<Time> {GetVertexCount()},
-		{}
-	};
+	auto& buses = transport_catalogue_.GetBuses();
+
+	std::vector<EdgeBatch> batches(buses.size());
+	parallel::ForEachIndex(buses.size(), [this, &buses, &batches](size_t bus_id) {
+		batches[bus_id] = MakeBusEdges(buses[bus_id]);
+	});
+	return MergeBatches(std::move(batches));
+}
 
+Graph GraphBuilder::Build(const Graph& previous, const std::vector<size_t>& previous_bus_ids,
+	const std::vector<size_t>& stop_ids) const {
 	auto& buses = transport_catalogue_.GetBuses();
 
-	for (const auto& bus : buses) {
-		AddForwardBusTrips(bus, graph);
-		if (!bus.circular_)
-			AddBackwardBusTrips(bus, graph);
+	// Рёбра автобуса идут подряд, автобусы — по порядку id, поэтому у каждого автобуса previous один диапазон рёбер
+	std::vector<graph::EdgeId> previous_begin;
+	std::vector<graph::EdgeId> previous_end;
+	for (graph::EdgeId edge_id = 0; edge_id < previous.edges.size(); ++edge_id) {
+		const size_t bus = previous.edges[edge_id].span.bus;
+		if (bus >= previous_begin.size()) {
+			previous_begin.resize(bus + 1, edge_id);
+			previous_end.resize(bus + 1, edge_id);
+		}
+		else if (previous_end[bus] != edge_id) {
+			// Граф построен не по автобусам подряд: переносить нечего, строим заново
+			return Build();
+		}
+		previous_end[bus] = edge_id + 1;
+	}
+
+	std::vector<EdgeBatch> batches(buses.size());
+	parallel::ForEachIndex(buses.size(), [&](size_t bus_id) {
+		const size_t previous_id = previous_bus_ids.at(bus_id);
+		if (previous_id == NO_BUS) {
+			batches[bus_id] = MakeBusEdges(buses[bus_id]);
+		}
+		else if (previous_id < previous_begin.size()) {
+			batches[bus_id] = CopyBusEdges(previous, previous_begin[previous_id], previous_end[previous_id], bus_id, stop_ids);
+		}
+	});
+	return MergeBatches(std::move(batches));
+}
+
+Graph GraphBuilder::MergeBatches(std::vector<EdgeBatch> batches) const {
+	size_t edge_count = 0;
+	for (const auto& batch : batches) {
+		edge_count += batch.edges.size();
+	}
+
+	std::vector<graph::Edge<Time>> edges;
+	std::vector<EdgeInfo> infos;
+	edges.reserve(edge_count);
+	infos.reserve(edge_count);
+	for (auto& batch : batches) {
+		edges.insert(edges.end(), batch.edges.begin(), batch.edges.end());
+		infos.insert(infos.end(), batch.infos.begin(), batch.infos.end());
+		batch = {};
 	}
 
-	return graph;
+	return Graph{
+		DirectedGraph{ GetVertexCount(), std::move(edges) },
+		std::move(infos)
+	};
 }
 
 size_t GraphBuilder::GetVertexCount() const {
@@ -66,15 +201,46 @@ size_t GraphBuilder::GetVertexCount() const {
 	return ret;
 }
 
-template<typename StopForwardIt>
-void GraphBuilder::AddBusTrips(const Bus& bus, Graph& graph, StopForwardIt stop_begin, StopForwardIt stop_end) const {
+GraphBuilder::EdgeBatch GraphBuilder::MakeBusEdges(const Bus& bus) const {
+	const auto stop_ids = transport_catalogue_.GetBusStopIds(&bus);
+
+	EdgeBatch batch;
+	if (stop_ids.begin() == stop_ids.end()) {
+		return batch;
+	}
+	AddForwardBusTrips(bus.id_, stop_ids, batch);
+	if (!bus.circular_)
+		AddBackwardBusTrips(bus.id_, stop_ids, batch);
+	return batch;
+}
+
+GraphBuilder::EdgeBatch GraphBuilder::CopyBusEdges(const Graph& previous, graph::EdgeId begin, graph::EdgeId end,
+	size_t bus_id, const std::vector<size_t>& stop_ids) const {
+	EdgeBatch batch;
+	batch.edges.reserve(end - begin);
+	batch.infos.reserve(end - begin);
+	for (graph::EdgeId edge_id = begin; edge_id < end; ++edge_id) {
+		graph::Edge<Time> edge = previous.directed_weighted_graph.GetEdge(edge_id);
+		EdgeInfo info = previous.edges[edge_id];
+		edge.from = stop_ids.at(edge.from);
+		edge.to = stop_ids.at(edge.to);
+		info.wait.stop = stop_ids.at(info.wait.stop);
+		info.span.bus = bus_id;
+		batch.edges.push_back(edge);
+		batch.infos.push_back(info);
+	}
+	return batch;
+}
+
+template<typename StopIdIt>
+void GraphBuilder::AddBusTrips(size_t bus_id, EdgeBatch& batch, StopIdIt stop_begin, StopIdIt stop_end) const {
 
 	std::vector<std::tuple<graph::VertexId, Time, size_t>> to_time_spans;
 
 	for (auto from_it = stop_begin, to_it = from_it++; from_it != stop_end; ++to_it, ++from_it) {
-		Time from_to_time = GetTime(*from_it, *to_it);
-		graph::VertexId to_id = transport_catalogue_.GetStopIndex((*to_it)->name_);// stop_to_vertex_.at(*to_it);
-		graph::VertexId from_id = transport_catalogue_.GetStopIndex((*from_it)->name_);//stop_to_vertex_.at(*from_it);
+		const graph::VertexId to_id = *to_it;
+		const graph::VertexId from_id = *from_it;
+		Time from_to_time = GetTime(from_id, to_id);
 		for (auto& [id, time, spans] : to_time_spans) {
 			time += from_to_time;
 			++spans;
@@ -82,9 +248,9 @@ void GraphBuilder::AddBusTrips(const Bus& bus, Graph& graph, StopForwardIt stop_
 		to_time_spans.push_back({ to_id , from_to_time, 1 });
 		for (auto& [id, time, spans] : to_time_spans) {
 			if (id != from_id) {
-				AddEdge(graph, from_id, id, {
-						Wait{ transport_catalogue_.GetStopIndex((*from_it)->name_), settings_.bus_wait_time},
-						Span{ transport_catalogue_.GetBusIndex(bus.name_), time, spans}
+				AddEdge(batch, from_id, id, {
+						Wait{ from_id, settings_.bus_wait_time},
+						Span{ bus_id, time, spans}
 					}
 				);
 			}
@@ -93,41 +259,29 @@ void GraphBuilder::AddBusTrips(const Bus& bus, Graph& graph, StopForwardIt stop_
 }
 
 
-void GraphBuilder::AddForwardBusTrips(const Bus& bus, Graph& graph) const {
+void GraphBuilder::AddForwardBusTrips(size_t bus_id, TransportCatalogue::StopIds stop_ids, EdgeBatch& batch) const {
 
-	auto& stops = bus.stops_;
-	AddBusTrips(bus, graph, stops.rbegin(), stops.rend());
+	AddBusTrips(bus_id, batch, std::make_reverse_iterator(stop_ids.end()), std::make_reverse_iterator(stop_ids.begin()));
 }
 
-void GraphBuilder::AddBackwardBusTrips(const Bus& bus, Graph& graph) const {
+void GraphBuilder::AddBackwardBusTrips(size_t bus_id, TransportCatalogue::StopIds stop_ids, EdgeBatch& batch) const {
 
-	auto& stops = bus.stops_;
-	AddBusTrips(bus, graph, stops.begin(), stops.end());
+	AddBusTrips(bus_id, batch, stop_ids.begin(), stop_ids.end());
 }
 
-Time GraphBuilder::GetTime(const Stop* from, const Stop* to) const {
-	auto length_meters = transport_catalogue_.GetLengthFromTo(from, to);
+Time GraphBuilder::GetTime(size_t from_id, size_t to_id) const {
+	auto length_meters = transport_catalogue_.GetLengthFromTo(from_id, to_id);
 	return static_cast<double>(length_meters) / bus_velocity_meters_per_min_;
 }
 
-void GraphBuilder::AddEdge(Graph& graph, graph::VertexId from, graph::VertexId to, EdgeInfo edge) const {
+void GraphBuilder::AddEdge(EdgeBatch& batch, graph::VertexId from, graph::VertexId to, EdgeInfo edge) const {
 
-	graph.edges.push_back(std::move(edge));
-	try {
-		auto& edge = graph.edges.back();
-		graph.directed_weighted_graph.AddEdge({
-			from,
-			to,
-			edge.wait.time + edge.span.time
-			});
-	}
-	catch (const std::exception& e) {
-		graph.edges.pop_back();
-		throw e;
-	}
-	catch (...) {
-		throw - 1;
-	}
+	batch.edges.push_back({
+		from,
+		to,
+		edge.wait.time + edge.span.time
+		});
+	batch.infos.push_back(std::move(edge));
 }
 
 } // namespace router
@@ -1,8 +1,11 @@
 #pragma once
 
 #include "transport_catalogue.h"
+#include <limits>
 #include <variant>
 #include "router.h"
+#include "dijkstra_router.h"
+#include "contraction_hierarchy.h"
 
 
 namespace transport {
@@ -12,9 +15,18 @@ namespace router {
 	using Time = double;
 	using Speed = double;
 
+	//   :      ,
+	//         ,   make_base
+	enum class RouterEngine {
+		ALL_PAIRS,
+		DIJKSTRA,
+		CONTRACTION_HIERARCHY
+	};
+
 	struct RouterSettings {
 		Time bus_wait_time = 6;
 		Speed bus_velocity = 40;
+		RouterEngine engine = RouterEngine::ALL_PAIRS;
 	};
 
 	struct Wait {
@@ -33,30 +45,52 @@ namespace router {
 		Span span;
 	};
 
+	using DirectedGraph = graph::FrozenDirectedWeightedGraph<Time>;
+
 	struct Graph {
-		graph::DirectedWeightedGraph<Time> directed_weighted_graph;
-		std::vector<EdgeInfo> edges;
+		DirectedGraph directed_weighted_graph;
+		ranges::Storage<EdgeInfo> edges;
 	};
 
 	class GraphBuilder {
 	public:
+		static constexpr size_t NO_BUS = std::numeric_limits<size_t>::max();
+
 		GraphBuilder(const TransportCatalogue& transport_catalogue, RouterSettings settings);
 		Graph Build() const;
+		//  ,      previous   .
+		// previous_bus_ids[bus_id]  id   previous,     bus_id,  NO_BUS,
+		//    ; stop_ids  id  previous  id  .
+		// и      ,    
+		Graph Build(const Graph& previous, const std::vector<size_t>& previous_bus_ids,
+			const std::vector<size_t>& stop_ids) const;
 	private:
 		const TransportCatalogue& transport_catalogue_;
 		RouterSettings settings_;
 		Speed bus_velocity_meters_per_min_;
 
+		// и  .     
+		//     ,   id      
+		struct EdgeBatch {
+			std::vector<graph::Edge<Time>> edges;
+			std::vector<EdgeInfo> infos;
+		};
+
 		size_t GetVertexCount() const;
+		Graph MergeBatches(std::vector<EdgeBatch> batches) const;
 
-		template<typename StopForwardIt>
-		void AddBusTrips(const Bus& bus, Graph& graph, StopForwardIt stop_begin, StopForwardIt stop_end) const;
-		void AddForwardBusTrips(const Bus& bus, Graph& graph) const;
-		void AddBackwardBusTrips(const Bus& bus, Graph& graph) const;
+		EdgeBatch MakeBusEdges(const Bus& bus) const;
+		EdgeBatch CopyBusEdges(const Graph& previous, graph::EdgeId begin, graph::EdgeId end, size_t bus_id,
+			const std::vector<size_t>& stop_ids) const;
 
-		void AddEdge(Graph& graph, graph::VertexId from, graph::VertexId to, EdgeInfo edge) const;
+		template<typename StopIdIt>
+		void AddBusTrips(size_t bus_id, EdgeBatch& batch, StopIdIt stop_begin, StopIdIt stop_end) const;
+		void AddForwardBusTrips(size_t bus_id, TransportCatalogue::StopIds stop_ids, EdgeBatch& batch) const;
+		void AddBackwardBusTrips(size_t bus_id, TransportCatalogue::StopIds stop_ids, EdgeBatch& batch) const;
 
-		Time GetTime(const Stop* from, const Stop* to) const;
+		void AddEdge(EdgeBatch& batch, graph::VertexId from, graph::VertexId to, EdgeInfo edge) const;
+
+		Time GetTime(size_t from_id, size_t to_id) const;
 	};
 
 
@@ -65,8 +99,18 @@ namespace router {
 		using Event = std::variant< Wait, Span>;
 
 
+		using RoutesTable = graph::Router<Time, DirectedGraph>::RoutesTable;
+		using ContractionHierarchy = graph::ContractionHierarchyRouter<Time, DirectedGraph>::Hierarchy;
+		using SearchGraph = graph::ContractionHierarchyRouter<Time, DirectedGraph>::SearchGraph;
+
 		Router(const TransportCatalogue& transport_catalogue, RouterSettings settings);
-		Router(Graph graph);
+		Router(Graph graph, RouterSettings settings);
+		//  ALL_PAIRS      
+		Router(Graph graph, RouterSettings settings, RoutesTable routes);
+		//  CONTRACTION_HIERARCHY      
+		Router(Graph graph, RouterSettings settings, ContractionHierarchy hierarchy);
+		//      :   ,        
+		Router(Graph graph, RouterSettings settings, ContractionHierarchy hierarchy, SearchGraph search_graph);
 
 		struct RouteInfo {
 			Time total_time;
@@ -76,9 +120,28 @@ namespace router {
 		std::optional<RouteInfo> BuildRoute(size_t from_index, size_t to_index) const;
 
 		const Graph& GetGraph() const;
+		const RouterSettings& GetSettings() const;
+		//   ,      ,  nullptr
+		const RoutesTable* GetRoutesTable() const;
+		//  ,     ,  nullptr
+		const ContractionHierarchy* GetContractionHierarchy() const;
+		//     ,     ,  nullptr
+		const SearchGraph* GetSearchGraph() const;
 	private:
+		using Engine = std::variant<
+			graph::Router<Time, DirectedGraph>,
+			graph::DijkstraRouter<Time, DirectedGraph>,
+			graph::ContractionHierarchyRouter<Time, DirectedGraph>>;
+
+		static Engine MakeEngine(const DirectedGraph& graph, RouterEngine engine);
+		static Engine MakeEngine(const DirectedGraph& graph, RouterEngine engine, RoutesTable routes);
+		static Engine MakeEngine(const DirectedGraph& graph, RouterEngine engine, ContractionHierarchy hierarchy);
+		static Engine MakeEngine(const DirectedGraph& graph, RouterEngine engine, ContractionHierarchy hierarchy,
+			SearchGraph search_graph);
+
+		RouterSettings settings_;
 		std::unique_ptr<Graph> graph_;//unique_ptr  router_      
-		graph::Router<Time> router_;
+		Engine router_;
 	};
 	
 } // namespace router